@@ -1,8 +1,18 @@
-﻿#include "Checker.h"
+﻿#include "Aggregator.h"
+#include "Baseline.h"
+#include "Checker.h"
 #include "Helper.h"
 #include "IniFile.h"
 #include "Log.h"
+#include "Profiler.h"
+#include "ResultCache.h"
 #include "Settings.h"
+#include "TargetFiles.h"
+#include "Trace.h"
+#include "Watcher.h"
+#include "Checker/WorkerProcess.h"
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
 #include <regex>
@@ -41,9 +51,9 @@ static void loadFromInput(IniFile& targetIni) {
 	}
 }
 
-static void loadFromArg(int argc, char* argv[], IniFile& targetIni) {
-	for (int i = 1; i < argc; ++i) {
-		std::filesystem::path path(argv[i]);
+static void loadFromArg(const std::vector<std::string>& paths, IniFile& targetIni) {
+	for (const auto& arg : paths) {
+		std::filesystem::path path(arg);
 		if (std::filesystem::is_regular_file(path))
 			targetIni.load(path.string());
 		else if (std::filesystem::is_directory(path)) {
@@ -59,6 +69,48 @@ static void loadFromArg(int argc, char* argv[], IniFile& targetIni) {
 	}
 }
 
+static void check(Checker& checker, Log& log) {
+	checker.checkFile();
+
+	log.output();
+	Profiler::report();
+	Trace::flush();
+	std::cout << "\n检查完毕" << std::endl;
+}
+
+// 监视目标文件、include的文件和脚本目录, 保存后只重新加载改变的文件并检查, 控制台只输出新增和消失的日志
+// 编辑器保存时往往连续写入多次, 最后一次改变后等待WatchDelay才开始检查
+static void watchFiles(Checker& checker, const std::vector<LogEntry>& configLogs, IniFile& targetIni, TargetFiles& targetFiles, Log& log) {
+	constexpr auto WatchDelay = std::chrono::milliseconds(300);
+	auto scriptDir = std::filesystem::absolute("Scripts").lexically_normal();
+	Watcher watcher;
+	if (std::filesystem::is_directory(scriptDir))
+		watcher.add(scriptDir);
+
+	while (true) {
+		check(checker, log);
+		// include可能引入了新的目录
+		for (const auto& directory : targetFiles.directories())
+			watcher.add(directory);
+		std::cout << "正在监视文件改变, 按Ctrl+C退出" << std::endl;
+
+		std::vector<std::filesystem::path> changed;
+		bool scriptChanged = false;
+		do {
+			changed = watcher.wait(WatchDelay);
+			scriptChanged = std::any_of(changed.begin(), changed.end(), [&](const std::filesystem::path& path) {
+				return path == scriptDir || (path.parent_path() == scriptDir && path.extension() == ".py");
+			});
+		} while (!targetFiles.reload(targetIni, changed, scriptChanged));
+
+		if (scriptChanged)
+			checker.reloadScripts();
+		// 配置不重新加载, 其日志也要重新产生, 否则会显示为消失
+		Log::replay(configLogs);
+		std::cout << std::format("\n检测到{}个文件改变, 重新检查", changed.size()) << std::endl;
+	}
+}
+
 static void loadAgain(IniFile& targetIni) {
 	std::cout << "按任意键继续检测..." << std::endl;
 	std::cin.ignore((std::numeric_limits<std::streamsize>::max)(), '\n');
@@ -69,6 +121,10 @@ static void loadAgain(IniFile& targetIni) {
 
 int main(int argc, char* argv[]) {
     try {
+		// 并行执行Python脚本的工作进程, 工作目录继承自父进程, 不修改控制台
+		if (auto parent = WorkerProcess::connect(argc, argv))
+			return CustomChecker::serve(*parent);
+
 		SetConsoleOutputCP(CP_UTF8);
 		system("title INI Validator");
 #ifndef _DEBUG
@@ -76,24 +132,70 @@ int main(int argc, char* argv[]) {
 		std::filesystem::current_path(exe_path);
 #endif // !_DEBUG
 
+		// 解析命令行选项, 其余参数为要检查的文件或目录
+		std::vector<std::string> paths;
+		std::string tracePath;
+		bool profile = false;
+		bool watch = false;
+		for (int i = 1; i < argc; ++i) {
+			std::string_view arg = argv[i];
+			if (arg == "--profile")
+				profile = true;
+			else if (arg == "--watch")
+				watch = true;
+			else if (arg == "--trace") {
+				// 输出文件不能省略, 也不能是另一个选项
+				if (i + 1 >= argc || std::string_view(argv[i + 1]).starts_with("--"))
+					throw std::runtime_error("用法: --trace <输出文件>");
+				tracePath = argv[++i];
+			}
+			else
+				paths.emplace_back(arg);
+		}
+		Profiler::init(profile, !tracePath.empty());
+		Trace::init(tracePath);
+
         auto log = Log();
-		Settings setting(IniFile("Settings.ini", true));
-		IniFile configIni("INICodingCheck.ini", true);
+		// 配置只加载一次, 其日志记录下来, 监视模式每次重新检查时重新产生
+		std::vector<LogEntry> configLogs;
+		auto loadConfig = [&](const std::string& path) {
+			Log::Capture capture(configLogs);
+			return IniFile(path, true);
+		};
+		Settings setting(loadConfig("Settings.ini"));
+		Baseline::init(setting.baseline, setting.updateBaseline);
+		// 监视模式按每条日志的指纹比较前后两次输出, 聚合后只剩每组第一条, 因此不聚合
+		Aggregator::init(setting.aggregate && !watch, setting.aggregateLocations);
+		ResultCache::init(setting.cache, { "Settings.ini", "INICodingCheck.ini" }, watch);
+		IniFile configIni = loadConfig("INICodingCheck.ini");
+
+		// 监视模式没有指定路径时监视默认目录
+		if (watch && paths.empty() && !setting.folderPath.empty())
+			paths.push_back(setting.folderPath);
+		if (watch && paths.empty())
+			throw std::runtime_error("监视模式需要指定要检查的文件或目录");
 
 		IniFile targetIni;
-		if (argc >= 2)
-			loadFromArg(argc, argv, targetIni);
+		TargetFiles targetFiles(paths);
+		if (watch) {
+			Log::DeltaOutput = true;
+			targetFiles.load(targetIni);
+		}
+		else if (!paths.empty())
+			loadFromArg(paths, targetIni);
 		else
 			loadFromInput(targetIni);
 		SetConsoleCP(CP_UTF8);
 
+		// 配置和Python解释器只加载一次, 之后每次只重新加载并检查目标文件
+		auto checker = [&] {
+			Log::Capture capture(configLogs);
+			return Checker(configIni, targetIni);
+		}();
+		if (watch)
+			watchFiles(checker, configLogs, targetIni, targetFiles, log);
 		while (true) {
-			Checker checker(configIni, targetIni);
-			checker.checkFile();
-
-			log.output();
-			std::cout << "\n检查完毕" << std::endl;
-
+			check(checker, log);
 			loadAgain(targetIni);
 		}
     }
@@ -42,3 +42,10 @@ def validate(section, key, value, type):
         return 2, f"存在非法字符或格式错误: {remaining}"
 
     return -1, f""
+
+
+def validate_batch(items):
+    """
+    一次性检查多个键值, items为(section, key, value, type)元组的列表, 返回与之一一对应的结果列表。
+    """
+    return [validate(*item) for item in items]
@@ -0,0 +1,37 @@
+﻿#include "Aggregator.h"
+
+bool Aggregator::Enabled = false;
+size_t Aggregator::MaxLocations = 5;
+std::array<Aggregator::Stripe, Aggregator::StripeCount> Aggregator::Stripes;
+
+void Aggregator::init(bool enabled, size_t maxLocations) {
+	Enabled = enabled;
+	MaxLocations = maxLocations;
+}
+
+// 记录一次出现, 返回true代表是该组的第一条日志, 需要正常保存
+bool Aggregator::add(uint64_t key, const Location& location, uint64_t fingerprint) {
+	auto& stripe = Stripes[key % StripeCount];
+	std::lock_guard<std::mutex> lock(stripe.mutex);
+	auto& group = stripe.groups[key];
+	if (group.locations.size() < MaxLocations)
+		group.locations.push_back(location);
+	if (fingerprint)
+		group.fingerprints.push_back(fingerprint);
+	return ++group.count == 1;
+}
+
+// 输出阶段调用, 此时不再有新日志产生, 返回的指针在clear之前有效
+const Aggregator::Group* Aggregator::find(uint64_t key) {
+	auto& stripe = Stripes[key % StripeCount];
+	std::lock_guard<std::mutex> lock(stripe.mutex);
+	auto it = stripe.groups.find(key);
+	return it != stripe.groups.end() ? &it->second : nullptr;
+}
+
+void Aggregator::clear() {
+	for (auto& stripe : Stripes) {
+		std::lock_guard<std::mutex> lock(stripe.mutex);
+		stripe.groups.clear();
+	}
+}
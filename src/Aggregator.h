@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 日志聚合: 规则、级别和参数都相同(即文本相同)的日志只保存第一条, 其余只计数并记录前N个位置
+// 分组表按哈希分为多段, 每段单独加锁, 多线程同时产生日志时互不阻塞
+class Aggregator {
+public:
+	struct Location {
+		uint32_t fileIndex{ };
+		int32_t line{ };
+		uint32_t section{ };	// 节名在字符串池中的编号
+	};
+
+	struct Group {
+		size_t count{ };
+		std::vector<Location> locations;	// 最多MaxLocations个, 包含第一条日志的位置
+		std::vector<uint64_t> fingerprints;	// 每次出现的基线指纹, 仅在更新基线时记录
+	};
+
+	static void init(bool enabled, size_t maxLocations);
+	static bool add(uint64_t key, const Location& location, uint64_t fingerprint);
+	static const Group* find(uint64_t key);
+	static void clear();
+
+	static bool Enabled;
+	static size_t MaxLocations;
+
+private:
+	struct Stripe {
+		std::mutex mutex;
+		std::unordered_map<uint64_t, Group> groups;
+	};
+
+	static constexpr size_t StripeCount = 64;
+	static std::array<Stripe, StripeCount> Stripes;
+};
@@ -0,0 +1,55 @@
+﻿#include "Baseline.h"
+#include "Log.h"
+#include <charconv>
+#include <fstream>
+#include <set>
+
+bool Baseline::Enabled = false;
+bool Baseline::Update = false;
+std::atomic<size_t> Baseline::Suppressed(0);
+std::string Baseline::Path;
+std::unordered_set<uint64_t> Baseline::Fingerprints;
+
+void Baseline::init(const std::string& path, bool update) {
+	Path = path;
+	Update = update;
+	Enabled = !path.empty();
+	if (Enabled && !Update)
+		load();
+}
+
+// 读取基线文件, 每行一个16位十六进制指纹, #开头的行为注释
+void Baseline::load() {
+	std::ifstream file(Path);
+	if (!file.is_open()) {
+		Log::out("基线文件不存在，将不忽略任何问题: {}", Path);
+		return;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line.front() == '#')
+			continue;
+		uint64_t fingerprint = 0;
+		auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), fingerprint, 16);
+		if (ec == std::errc())
+			Fingerprints.insert(fingerprint);
+	}
+}
+
+// 用本次的所有日志重新生成基线文件, 排序去重以便版本管理
+void Baseline::save(const std::vector<uint64_t>& fingerprints) {
+	if (!Enabled || !Update)
+		return;
+
+	std::ofstream file(Path, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		Log::out("无法写入基线文件: {}", Path);
+		return;
+	}
+
+	std::string buffer = "# INIValidator baseline\n";
+	for (auto fingerprint : std::set<uint64_t>(fingerprints.begin(), fingerprints.end()))
+		buffer += std::format("{:016x}\n", fingerprint);
+	file.write(buffer.data(), buffer.size());
+}
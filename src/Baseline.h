@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// 基线: 记录已知问题的指纹
+// 指纹由规则、文件、节、键、规范化后的值和字符串参数计算, 不包含行号, 增删行不会使基线失效
+// 命中基线的日志在产生时即被丢弃, 不会被保存、格式化或输出
+class Baseline {
+public:
+	static void init(const std::string& path, bool update);
+	static void save(const std::vector<uint64_t>& fingerprints);
+	static bool contains(uint64_t fingerprint) { return Fingerprints.contains(fingerprint); }
+
+	static bool Enabled;					// 是否需要计算日志指纹
+	static bool Update;						// 为true时不忽略任何问题, 并在输出时重新生成基线
+	static std::atomic<size_t> Suppressed;	// 本次检查中被基线忽略的日志数, 输出后清零
+
+private:
+	static void load();
+
+	static std::string Path;
+	static std::unordered_set<uint64_t> Fingerprints;
+};
@@ -1,7 +1,9 @@
 ﻿#include "Checker.h"
 #include "Helper.h"
 #include "Log.h"
+#include "Profiler.h"
 #include "ProgressBar.h"
+#include "ResultCache.h"
 #include <iostream>
 #include <set>
 #include <sstream>
@@ -11,9 +13,11 @@ Checker* Checker::Instance = nullptr;
 std::atomic<size_t> Checker::ProcessedSections(0);
 
 Checker::Checker(IniFile& configFile, IniFile& targetIni) : targetIni(&targetIni) {
+	Profiler::Scope profile(Profiler::Category::Phase, "加载配置");
 	loadConfig(configFile);
 	Instance = this;
-	scripts = std::make_unique<CustomChecker>("Scripts", targetIni);
+	scripts = std::make_unique<CustomChecker>("Scripts");
+	plugins = std::make_unique<PluginChecker>("Scripts");
 }
 
 // 加载配置文件
@@ -41,6 +45,12 @@ void Checker::loadConfig(IniFile& configFile) {
 		for (const auto& [name, type] : configFile.sections.at("Registries"))
 			registries[name] = RegistryChecker(this, configFile.sections, name, type);
 
+	// 加载元组限制器, 各位置引用的数值、字符串限制器和注册表需先加载
+	if (configFile.sections.contains("Tuples"))
+		for (const auto& [key, _] : configFile.sections.at("Tuples"))
+			if (configFile.sections.contains(key))
+				tuples[key] = TupleChecker(this, configFile.sections.at(key));
+
 	// 加载全局类型
 	if (configFile.sections.contains("Globals"))
 		for (const auto& [key, _] : configFile.sections.at("Globals"))
@@ -53,12 +63,34 @@ void Checker::loadConfig(IniFile& configFile) {
 			if (configFile.sections.contains(key))
 				sections[key] = Dict(configFile.sections.at(key));
 
+	// 加载键间约束
+	if (configFile.sections.contains("Constraints"))
+		for (const auto& [type, name] : configFile.sections.at("Constraints"))
+			if (configFile.sections.contains(name))
+				constraints[type] = ConstraintChecker(configFile.sections.at(name));
+
 }
 
 // 验证每个注册表的内容
+// 同一个Checker可以反复检查: 配置和已导入的脚本保留, 只有targetIni需要重新加载
 void Checker::checkFile() {
+	scripts->attach(*targetIni);
+	plugins->attach(*targetIni);
+	ResultCache::begin(targetIni->sections);
+
+	// 元组的注册表字段逐个按名字查找, 先为每个注册表建立一次集合
+	registeredNames.clear();
+	for (const auto& [registryName, _] : registries) {
+		auto it = targetIni->sections.find(registryName);
+		if (it == targetIni->sections.end())
+			continue;
+		auto& names = registeredNames[registryName];
+		for (const auto& entry : it->second)
+			names.insert(entry.second.value);
+	}
 
 	// [Globals] General
+	Profiler::Scope profile(Profiler::Category::Phase, "检查全局部分");
 	Progress::start("检查全局部分", globals.size());
 	for (const auto& [globalName, _] : globals) {
 		Progress::update();
@@ -70,8 +102,10 @@ void Checker::checkFile() {
 	}
 
 	// [Registries] VehicleTypes=UnitType
+	profile.next("检查注册节");
 	Progress::start("检查注册节", targetIni->sections.size());
 	for (const auto& [registryName, type] : registries) {
+		Profiler::Scope profileRegistry(Profiler::Category::Registry, registryName);
 		// 检查预注册项
 		type.validateAllPreserItems(registryName);
 
@@ -86,15 +120,29 @@ void Checker::checkFile() {
 		auto& registry = targetIni->sections.at(registryName);
 		registry.isScanned = true;
 
+		// 注册项是节名时, 同一个节注册两次也算重复; 留空的注册项代表清除, 不算重复
 		if (sections.contains(type))
-			for (const auto& [_, name] : registry)
+			for (const auto& [key, name] : registry) {
+				if (!name.value.empty())
+					uniques.insert("[" + registryName + "]", registry, key, name.value);
 				type.validateSection(registryName, name);
+			}
 		else
 			for (const auto& [name, value] : registry)
 				validate(registry, name, value, type);
 	}
 
+	// 定义了validate_batch的脚本和插件在遍历结束后统一执行
+	profile.next("执行批量脚本");
+	plugins->flush();
+	scripts->flush();
+
+	// 遍历时只记录值的位置, 全部记录完才能确定首次定义
+	profile.next("检查重复值");
+	uniques.report();
+
 	// 检查剩余未检测的节
+	profile.next("检查剩余未注册节");
 	Progress::start("检查剩余未注册节", targetIni->sections.size());
 	for (const auto& [name, section] : targetIni->sections) {
 		if (!section.isScanned) {
@@ -103,6 +151,7 @@ void Checker::checkFile() {
 			Log::info<_UnreachableSection>({ section.line, section.fileIndex }, section.name);
 		}
 	}
+	ResultCache::save();
 }
 
 // 验证键值对
@@ -117,13 +166,50 @@ void Checker::validate(const Section& section, const std::string& key, const Val
 	else if (numberLimits.contains(type)) numberLimits.at(type).validate(section, key, value);
 	else if (limits.contains(type)) limits.at(type).validate(section, key, value);
 	else if (lists.contains(type)) lists.at(type).validate(section, key, value); // 新增
+	else if (tuples.contains(type)) tuples.at(type).validate(section, key, value);
 	//else if (registries.contains(type)) registries.at(type).validate(section, key, value, type);
 	else if (sections.contains(type)) TypeChecker::validate(section, key, value, type);
-	else if (scripts->contains(type)) scripts->validate(section, key, value, type);
+	// 脚本和插件可以读取整个ini, 其结果不能按节缓存
+	else if (plugins->contains(type)) {
+		ResultCache::uncacheable();
+		plugins->validate(section, key, value, type);
+	}
+	else if (scripts->contains(type)) {
+		ResultCache::uncacheable();
+		scripts->validate(section, key, value, type);
+	}
 	else Log::print<_TypeNotExist>({ value.line }, type);
 }
 
+// 按类型检查目标ini中的节, 用于缓存命中时继续检查其引用的节
+void Checker::validateSection(const std::string& name, const std::string& type) {
+	auto section = targetIni->sections.find(name);
+	auto dict = sections.find(type);
+	if (section != targetIni->sections.end() && dict != sections.end())
+		dict->second.validateSection(section->second, type);
+}
+
+// 节中所有键检查完毕后, 再检查该类型的键间约束
+void Checker::validateConstraints(const Section& section, const std::string& type) const {
+	if (auto it = constraints.find(type); it != constraints.end())
+		it->second.validate(section);
+}
+
+void Checker::validateUnique(UniqueChecker::Scope scope, const std::string& type, const Section& section, const std::string& key, const Value& value) {
+	switch (scope) {
+	case UniqueChecker::Scope::Registry:
+		return uniques.insert("registry|" + type + "|" + key, section, key, value.value);
+	case UniqueChecker::Scope::File:
+		return uniques.insert("file|" + value.filetype + "|" + key, section, key, value.value);
+	case UniqueChecker::Scope::Global:
+		return uniques.insert("global|" + key, section, key, value.value);
+	default:
+		break;
+	}
+}
+
 int Checker::validateInteger(const Section& section, const std::string& key, const Value& value) {
+	Profiler::Scope profile(Profiler::Category::Checker, "int");
 	int result = 0;
 	try {
 		int base = 10;
@@ -152,6 +238,7 @@ int Checker::validateInteger(const Section& section, const std::string& key, con
 }
 
 float Checker::validateFloat(const Section& section, const std::string& key, const Value& value) {
+	Profiler::Scope profile(Profiler::Category::Checker, "float");
 	float result = 0.0f;
 	try {
 		std::string buffer = value;
@@ -179,6 +266,7 @@ float Checker::validateFloat(const Section& section, const std::string& key, con
 }
 
 double Checker::validateDouble(const Section& section, const std::string& key, const Value& value) {
+	Profiler::Scope profile(Profiler::Category::Checker, "double");
 	double result = 0.0;
 	try {
 		std::string buffer = value;
@@ -203,6 +291,7 @@ double Checker::validateDouble(const Section& section, const std::string& key, c
 }
 
 std::string Checker::validateString(const Section& section, const std::string& key, const Value& value) {
+	Profiler::Scope profile(Profiler::Category::Checker, "string");
 	if (value.value.size() > 512)
 		Log::error<_OverlongString>({ section, key }, value);
 
@@ -1,10 +1,14 @@
 ﻿#pragma once
+#include "Checker/ConstraintChecker.h"
 #include "Checker/CustomChecker.h"
 #include "Checker/LimitChecker.h"
 #include "Checker/ListChecker.h"
 #include "Checker/NumberChecker.h"
+#include "Checker/PluginChecker.h"
 #include "Checker/RegistryChecker.h"
+#include "Checker/TupleChecker.h"
 #include "Checker/TypeChecker.h"
+#include "Checker/UniqueChecker.h"
 #include "Dict.h"
 #include "IniFile.h"
 #include <string>
@@ -18,8 +22,12 @@ public:
 	Checker(IniFile& configFile, IniFile& targetIni);
 	void loadConfig(IniFile& configFile);
 	void checkFile();
+	void reloadScripts() { scripts->reload(); }
 
 	void validate(const Section& section, const std::string& key, const Value& value, const std::string& type);
+	void validateSection(const std::string& name, const std::string& type);
+	void validateConstraints(const Section& section, const std::string& type) const;
+	void validateUnique(UniqueChecker::Scope scope, const std::string& type, const Section& section, const std::string& key, const Value& value);
 	
 private:
 	template<class T>
@@ -28,22 +36,31 @@ private:
 	using Globals = map<Dict>;
 	using Sections = map<Dict>;
 	using Scripts = std::unique_ptr<CustomChecker>;
+	using Plugins = std::unique_ptr<PluginChecker>;
 	using Limits = map<LimitChecker>;
 	using Lists = map<ListChecker>;
 	using Numbers = map<NumberChecker>;
+	using Tuples = map<TupleChecker>;
+	using Constraints = map<ConstraintChecker>;
 
 	friend RegistryChecker;
 	friend ListChecker;
+	friend TupleChecker;
 	friend TypeChecker;
 
 	Registrys registries;	// 注册表名字映射: 配置ini的Type名字 <-> 注册ini中注册表名字(注册表可能不存在,则value="")
 	Numbers numberLimits;	// 特殊类型限制: 类型名 <-> 数字限制类型section
 	Limits limits;			// 特殊类型限制: 类型名 <-> 范围限制类型section
 	Lists lists;			// 特殊类型限制: 类型名 <-> 列表限制类型section
+	Tuples tuples;			// 特殊类型限制: 类型名 <-> 元组限制类型section
 	Globals globals;		// 全局类型限制: 类型名 <-> 确定名字类型section
 	Sections sections;		// 实例类型限制: 类型名 <-> 自定义类型section
+	Constraints constraints;	// 键间约束: 类型名 <-> 约束section
+	UniqueChecker uniques;	// 唯一性: 范围 + 值 <-> 出现位置, 每次检查结束时报告
 	Scripts scripts;		// 实例类型限制: 类型名 <-> 自定义检查器
+	Plugins plugins;		// 实例类型限制: 类型名 <-> 原生插件检查器
 	IniFile* targetIni;		// 检查的ini
+	NameMap<NameSet> registeredNames;	// 注册表名 <-> 目标ini中登记的名字, 每次检查前重建, 供元组按名字查找
 
 	int validateInteger(const Section& section, const std::string& key, const Value& str);
 	float validateFloat(const Section& section, const std::string& key, const Value& str);
@@ -0,0 +1,304 @@
+﻿#include "ConstraintChecker.h"
+#include "Helper.h"
+#include "Log.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+// 递归下降解析, 边解析边生成指令; 每一层把结果放在dst, 右操作数放在dst + 1
+class ConstraintChecker::Compiler {
+public:
+	explicit Compiler(Program& program) :program(program), text(program.expression) {}
+
+	void compile() {
+		parseOr(0);
+		skipSpace();
+		if (pos < text.size())
+			fail("无法识别的内容");
+		emit(Op::Bool, 0);
+	}
+
+private:
+	[[noreturn]] void fail(const std::string& message) const {
+		throw std::invalid_argument("第" + std::to_string(pos + 1) + "个字符处" + message);
+	}
+
+	void skipSpace() {
+		while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+			++pos;
+	}
+
+	bool accept(std::string_view token) {
+		skipSpace();
+		if (text.substr(pos, token.size()) != token)
+			return false;
+		pos += token.size();
+		return true;
+	}
+
+	static bool isKeyChar(char c) {
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+	}
+
+	uint8_t next(uint8_t dst) const {
+		if (dst + 1u >= MaxRegisters)
+			fail("嵌套过深");
+		return dst + 1;
+	}
+
+	size_t emit(Op op, uint8_t dst, uint8_t src = 0, uint32_t operand = 0) {
+		program.code.push_back({ op, dst, src, operand });
+		return program.code.size() - 1;
+	}
+
+	// 短路跳转统一跳到链的末尾, 再把结果归一为0/1
+	void patch(const std::vector<size_t>& jumps, uint8_t dst) {
+		if (jumps.empty())
+			return;
+		for (auto jump : jumps)
+			program.code[jump].operand = static_cast<uint32_t>(program.code.size());
+		emit(Op::Bool, dst);
+	}
+
+	void parseOr(uint8_t dst) {
+		parseAnd(dst);
+		std::vector<size_t> jumps;
+		while (accept("||")) {
+			jumps.push_back(emit(Op::JumpIfTrue, dst));
+			parseAnd(dst);
+		}
+		patch(jumps, dst);
+	}
+
+	void parseAnd(uint8_t dst) {
+		parseCompare(dst);
+		std::vector<size_t> jumps;
+		while (accept("&&")) {
+			jumps.push_back(emit(Op::JumpIfFalse, dst));
+			parseCompare(dst);
+		}
+		patch(jumps, dst);
+	}
+
+	void parseCompare(uint8_t dst) {
+		static constexpr std::pair<std::string_view, Op> Comparisons[] = {
+			{ "<=", Op::Le }, { ">=", Op::Ge }, { "==", Op::Eq }, { "!=", Op::Ne }, { "<", Op::Lt }, { ">", Op::Gt },
+		};
+		parseAdd(dst);
+		for (const auto& [token, op] : Comparisons) {
+			if (accept(token)) {
+				auto src = next(dst);
+				parseAdd(src);
+				emit(op, dst, src);
+				return;
+			}
+		}
+	}
+
+	void parseAdd(uint8_t dst) {
+		parseMul(dst);
+		while (true) {
+			skipSpace();
+			if (pos >= text.size() || (text[pos] != '+' && text[pos] != '-'))
+				return;
+			auto op = text[pos++] == '+' ? Op::Add : Op::Sub;
+			auto src = next(dst);
+			parseMul(src);
+			emit(op, dst, src);
+		}
+	}
+
+	void parseMul(uint8_t dst) {
+		parseUnary(dst);
+		while (true) {
+			skipSpace();
+			if (pos >= text.size() || (text[pos] != '*' && text[pos] != '/'))
+				return;
+			auto op = text[pos++] == '*' ? Op::Mul : Op::Div;
+			auto src = next(dst);
+			parseUnary(src);
+			emit(op, dst, src);
+		}
+	}
+
+	void parseUnary(uint8_t dst) {
+		skipSpace();
+		if (pos < text.size() && text[pos] == '!' && text.substr(pos, 2) != "!=") {
+			++pos;
+			parseUnary(dst);
+			emit(Op::Not, dst);
+		}
+		else if (pos < text.size() && text[pos] == '-') {
+			++pos;
+			parseUnary(dst);
+			emit(Op::Neg, dst);
+		}
+		else
+			parsePrimary(dst);
+	}
+
+	void parsePrimary(uint8_t dst) {
+		if (accept("(")) {
+			parseOr(dst);
+			if (!accept(")"))
+				fail("缺少)");
+			return;
+		}
+
+		auto token = parseToken();
+		if (token == "has" && accept("(")) {
+			auto key = parseToken();
+			if (!accept(")"))
+				fail("缺少)");
+			emit(Op::Has, dst, 0, keyIndex(key));
+			return;
+		}
+
+		// 整个记号都是数字时作为常量, 否则视为键名
+		if (string::isNumber(token)) {
+			size_t length = 0;
+			double value = 0;
+			try {
+				value = std::stod(token, &length);
+			}
+			catch (const std::exception&) {}
+			if (length == token.size()) {
+				program.constants.push_back(value);
+				emit(Op::Const, dst, 0, static_cast<uint32_t>(program.constants.size() - 1));
+				return;
+			}
+		}
+		emit(Op::Load, dst, 0, keyIndex(token));
+	}
+
+	std::string parseToken() {
+		skipSpace();
+		auto start = pos;
+		while (pos < text.size() && isKeyChar(text[pos]))
+			++pos;
+		if (start == pos)
+			fail(pos < text.size() ? "无法识别的字符" + std::string(1, text[pos]) : "缺少操作数");
+		return std::string(text.substr(start, pos - start));
+	}
+
+	uint32_t keyIndex(const std::string& key) {
+		auto it = std::find(program.keys.begin(), program.keys.end(), key);
+		if (it == program.keys.end())
+			it = program.keys.insert(it, key);
+		return static_cast<uint32_t>(it - program.keys.begin());
+	}
+
+	Program& program;
+	std::string_view text;
+	size_t pos{ 0 };
+};
+
+ConstraintChecker::ConstraintChecker(const Section& config) {
+	for (const auto& [name, value] : config) {
+		Program program{ name, value.value, value.line };
+		try {
+			Compiler(program).compile();
+			programs.push_back(std::move(program));
+		}
+		catch (const std::invalid_argument& e) {
+			Log::error<_ConstraintCheckerInvalid>({ config, name }, value.value, e.what());
+		}
+	}
+	// 按配置中的顺序执行, 同一节的报错顺序固定
+	std::sort(programs.begin(), programs.end(), [](const Program& a, const Program& b) { return a.line < b.line; });
+}
+
+// 数值, 百分数, 以及yes/no/true/false
+bool ConstraintChecker::toNumber(const std::string& value, double& result) {
+	if (value.empty())
+		return false;
+	char* end = nullptr;
+	result = std::strtod(value.c_str(), &end);
+	if (end != value.c_str()) {
+		if (*end == '\0')
+			return true;
+		if (*end == '%' && end[1] == '\0') {
+			result /= 100;
+			return true;
+		}
+	}
+
+	std::string lower = value;
+	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	if (lower == "yes" || lower == "true") {
+		result = 1;
+		return true;
+	}
+	if (lower == "no" || lower == "false") {
+		result = 0;
+		return true;
+	}
+	return false;
+}
+
+// 返回false表示约束引用的值取不到, 此时不做判断
+bool ConstraintChecker::run(const Program& program, const Section& section, bool& result) {
+	std::array<double, MaxRegisters> r{};
+	const auto& code = program.code;
+	for (size_t pc = 0; pc < code.size(); ++pc) {
+		const auto& instruction = code[pc];
+		double& dst = r[instruction.dst];
+		const double src = r[instruction.src];
+		switch (instruction.op) {
+		case Op::Const: dst = program.constants[instruction.operand]; break;
+		case Op::Load: {
+			auto it = section.section.find(program.keys[instruction.operand]);
+			if (it == section.section.end() || !toNumber(it->second.value, dst))
+				return false;
+			break;
+		}
+		case Op::Has: dst = section.contains(program.keys[instruction.operand]); break;
+		case Op::Neg: dst = -dst; break;
+		case Op::Not: dst = dst == 0; break;
+		case Op::Bool: dst = dst != 0; break;
+		case Op::Add: dst += src; break;
+		case Op::Sub: dst -= src; break;
+		case Op::Mul: dst *= src; break;
+		case Op::Div:
+			if (src == 0)
+				return false;
+			dst /= src;
+			break;
+		case Op::Lt: dst = dst < src; break;
+		case Op::Le: dst = dst <= src; break;
+		case Op::Gt: dst = dst > src; break;
+		case Op::Ge: dst = dst >= src; break;
+		case Op::Eq: dst = dst == src; break;
+		case Op::Ne: dst = dst != src; break;
+		case Op::JumpIfFalse:
+			if (dst == 0)
+				pc = instruction.operand - 1;
+			break;
+		case Op::JumpIfTrue:
+			if (dst != 0)
+				pc = instruction.operand - 1;
+			break;
+		}
+	}
+	result = r[0] != 0;
+	return true;
+}
+
+void ConstraintChecker::validate(const Section& section) const {
+	Profiler::Scope profile(Profiler::Category::Checker, "ConstraintChecker");
+	for (const auto& program : programs) {
+		bool result = true;
+		if (!run(program, section, result) || result)
+			continue;
+
+		// 定位到约束引用的第一个存在的键, 都不存在时定位到节名
+		auto key = std::find_if(program.keys.begin(), program.keys.end(), [&](const std::string& key) { return section.contains(key); });
+		if (key != program.keys.end())
+			Log::warning<_ConstraintCheckerFailed>({ section, *key }, program.name, program.expression);
+		else
+			Log::warning<_ConstraintCheckerFailed>({ section.name, section.fileIndex, section.line, true }, program.name, program.expression);
+	}
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+#include "IniFile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 同一节中多个键之间的约束, 在该节的所有键检查完毕后执行
+// [Constraints]
+// 类型名 = 约束节名, 例如TechnoType=TechnoConstraints
+// 约束节中每个键为约束名, 值为表达式, 结果为0时报错
+// 表达式支持数字、键名、has(键名)、括号、+ - * /、< <= > >= == !=、! && ||
+// 引用的键不存在或不是数值时跳过该约束, 需要要求键存在时用has()
+class ConstraintChecker {
+public:
+	ConstraintChecker() = default;
+	explicit ConstraintChecker(const Section& config);
+	void validate(const Section& section) const;
+
+private:
+	// 加载时编译为寄存器字节码, 检查时只按顺序执行指令, 不再解析字符串
+	enum class Op : uint8_t {
+		Const,			// r[dst] = constants[operand]
+		Load,			// r[dst] = 键keys[operand]的数值, 取不到时跳过整条约束
+		Has,			// r[dst] = 键keys[operand]是否存在
+		Neg, Not, Bool,	// r[dst] = -r[dst] / !r[dst] / r[dst] != 0
+		Add, Sub, Mul, Div, Lt, Le, Gt, Ge, Eq, Ne, // r[dst] = r[dst] op r[src]
+		JumpIfFalse,	// r[dst]为0时跳到operand, 用于&&短路
+		JumpIfTrue,		// r[dst]不为0时跳到operand, 用于||短路
+	};
+
+	struct Instruction {
+		Op op;
+		uint8_t dst{ 0 };
+		uint8_t src{ 0 };
+		uint32_t operand{ 0 };
+	};
+
+	struct Program {
+		std::string name;
+		std::string expression;
+		int line{ -1 };
+		std::vector<Instruction> code;
+		std::vector<double> constants;
+		std::vector<std::string> keys;	// 表达式引用的键, 报错时定位到其中第一个存在的键
+	};
+
+	static constexpr size_t MaxRegisters = 16;	// 表达式的嵌套深度上限
+
+	class Compiler;
+	static bool toNumber(const std::string& value, double& result);
+	static bool run(const Program& program, const Section& section, bool& result);
+
+	std::vector<Program> programs;
+};
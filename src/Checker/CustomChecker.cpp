@@ -1,41 +1,136 @@
 ﻿#include "CustomChecker.h"
+#include "Helper.h"
+#include "IniView.h"
 #include "Log.h"
+#include "LogBuffer.h"
+#include "Profiler.h"
+#include "Settings.h"
+#include "WorkerProcess.h"
 #include <iostream>
+#include <thread>
+
+// Python 3.12起子解释器可以拥有独立的GIL, 脚本才能在多个线程中真正并行执行
+// 更早的版本改为启动多个工作进程, 各自持有一份目标ini的副本
+#if PY_VERSION_HEX >= 0x030C0000
+#define IV_SUBINTERPRETERS
+#endif
+
+using binary::write;
+using binary::writeString;
+
+namespace {
+	// 工作进程的消息: 'I'为目标ini的副本, 'B'为一个批次; 脚本只能读取节名和值, 行号和原文用于定位日志
+	std::string encodeIni(const IniFile& ini) {
+		std::string message = "I";
+		write<uint64_t>(message, ini.sections.size());
+		for (const auto& [name, section] : ini.sections) {
+			writeString(message, name);
+			write<uint64_t>(message, section.section.size());
+			for (const auto& [key, value] : section) {
+				writeString(message, key);
+				writeString(message, value.value);
+				write<int32_t>(message, value.line);
+				writeString(message, value.origin);
+				write<uint64_t>(message, value.fileIndex);
+			}
+		}
+		return message;
+	}
+
+	void decodeIni(binary::Reader& reader, IniFile& ini) {
+		for (auto count = reader.read<uint64_t>(); count > 0; --count) {
+			auto name = reader.readString();
+			auto& section = ini.sections[name];
+			section.name = name;
+			for (auto values = reader.read<uint64_t>(); values > 0; --values) {
+				auto& value = section[reader.readString()];
+				value.value = reader.readString();
+				value.line = reader.read<int32_t>();
+				value.origin = reader.readString();
+				value.fileIndex = reader.read<uint64_t>();
+			}
+		}
+	}
 
-std::unordered_map<std::string, Section> CustomChecker::globalSections_;
-std::mutex globalSectionsMutex_;
+	void encodeLogs(std::string& message, const std::vector<LogEntry>& logs) {
+		write<uint64_t>(message, logs.size());
+		for (const auto& log : logs) {
+			write<uint8_t>(message, static_cast<uint8_t>(log.severity));
+			write<uint16_t>(message, static_cast<uint16_t>(log.rule));
+			write<int32_t>(message, log.data.line);
+			write<uint64_t>(message, log.data.fileindex);
+			writeString(message, log.data.section);
+			writeString(message, log.data.origin);
+			write<uint8_t>(message, log.data.isSectionName);
+			std::string args;
+			LogRecord::encodeArgs(args, log.args);
+			writeString(message, args);
+		}
+	}
+
+	std::vector<LogEntry> decodeLogs(binary::Reader& reader) {
+		std::vector<LogEntry> logs;
+		for (auto count = reader.read<uint64_t>(); count > 0; --count) {
+			auto& log = logs.emplace_back();
+			log.severity = static_cast<Severity>(reader.read<uint8_t>());
+			log.rule = static_cast<LogRule>(reader.read<uint16_t>());
+			log.data.line = reader.read<int32_t>();
+			log.data.fileindex = reader.read<uint64_t>();
+			log.data.section = reader.readString();
+			log.data.origin = reader.readString();
+			log.data.isSectionName = reader.read<uint8_t>();
+			log.args = LogRecord::decodeArgs(reader.readString());
+			if (log.rule >= LogRule::Count)
+				throw std::out_of_range("日志规则无效");
+		}
+		return logs;
+	}
+}
 
 static PyMethodDef CustomCheckerMethods[] = {
-	{"get_section",			CustomChecker::py_get_section,			METH_VARARGS, "获取指定的section字典"},
+	{"get_section",			CustomChecker::py_get_section,			METH_VARARGS, "获取指定的section, 与iv.ini[name]相同"},
 	{"get_section_value",	CustomChecker::py_get_section_value,	METH_VARARGS, "获取指定的section中的指定key的值"},
 	{nullptr, nullptr, 0, nullptr}  // 哨兵，用于结束方法列表
 };
 
+// 多阶段初始化, 每个子解释器导入iv时各自执行一次IniView::init
+static PyModuleDef_Slot CustomCheckerSlots[] = {
+	{Py_mod_exec, reinterpret_cast<void*>(IniView::init)},
+#ifdef Py_MOD_PER_INTERPRETER_GIL_SUPPORTED
+	{Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+	{0, nullptr}
+};
+
 static struct PyModuleDef customCheckerModule = {
 	PyModuleDef_HEAD_INIT,
 	"iv",  // 模块名
 	nullptr,           // 模块文档
-	-1,                // 模块状态
-	CustomCheckerMethods  // 模块方法列表
+	IniView::StateSize, // 模块状态
+	CustomCheckerMethods,  // 模块方法列表
+	CustomCheckerSlots,
+	nullptr,
+	nullptr,
+	IniView::release
 };
 
 PyMODINIT_FUNC PyInit_iv(void) {
-	return PyModule_Create(&customCheckerModule);
+	return PyModuleDef_Init(&customCheckerModule);
 }
 
-CustomChecker::Script::Script(PyObject* mod, PyObject* func)
-	: module(mod), func(func) {
+CustomChecker::Script::Script(PyObject* mod, PyObject* func, PyObject* batch, const std::string& type)
+	: module(mod), func(func), batch(batch), type(PyUnicode_FromString(type.c_str())) {
 }
 
 // 模块初始化函数
 CustomChecker::Script::~Script() {
+	Py_XDECREF(type);
+	Py_XDECREF(batch);
 	Py_XDECREF(func);
 	Py_XDECREF(module);
 }
 
-CustomChecker::CustomChecker(const std::string& scriptDir, const IniFile& targetIni) {
-	globalSections_ = targetIni.sections;
-
+CustomChecker::CustomChecker(const std::string& scriptDir) :scriptDir_(scriptDir) {
 	// 注册模块到 Python 解释器
 
 	if (PyImport_AppendInittab("iv", PyInit_iv) == -1) {
@@ -50,14 +145,64 @@ CustomChecker::CustomChecker(const std::string& scriptDir, const IniFile& target
 	PyRun_SimpleString("import locale; locale.setlocale(locale.LC_ALL, 'zh_CN.UTF-8')");
 	PyRun_SimpleString("import iv");
 	scanScriptDirectory(scriptDir); // 初始化支持的脚本类型
+	for (const auto& type : supportedTypes_)
+		usage_.try_emplace(type);
+
+	// 工作进程各自持有解释器和整份ini副本, 内存随进程数增长, 因此只在明确指定数量时启用
+	workers_ = Settings::Instance->pythonWorkers;
+	if (workers_ == 0)
+#ifdef IV_SUBINTERPRETERS
+		workers_ = std::max(1u, std::thread::hardware_concurrency());
+#else
+		workers_ = 1;
+#endif
 }
 
 CustomChecker::~CustomChecker() {
+	if (Py_IsInitialized()) {
+		stopWorkers();
+		IniView::detach();
+	}
 	scriptCache_.clear();
 	if (Py_IsInitialized())
 		Py_Finalize();
 }
 
+// 脚本通过iv直接读取targetIni, 不复制; 上一次检查的节对象和累计耗时在此清空
+void CustomChecker::attach(const IniFile& targetIni) {
+	if (!Py_IsInitialized())
+		return;
+	IniView::attach(targetIni);
+	target_ = &targetIni;
+	++attached_;
+	for (auto& [_, usage] : usage_) {
+		usage.elapsed = 0;
+		usage.exhausted = false;
+	}
+}
+
+// 脚本文件改变后重新导入: 从sys.modules中移除已导入的脚本, 下次调用时从文件重新导入
+// 子解释器随工作线程一起结束, 下次并行检查时重新创建并导入; 脚本自己导入的其他模块不会重新导入
+void CustomChecker::reload() {
+	if (!Py_IsInitialized())
+		return;
+	stopWorkers();
+	stopping_ = false;
+
+	PyObject* modules = PyImport_GetModuleDict(); // borrowed reference
+	for (const auto& type : supportedTypes_)
+		if (PyDict_GetItemString(modules, type.c_str()))
+			PyDict_DelItemString(modules, type.c_str());
+	PyRun_SimpleString("import importlib; importlib.invalidate_caches()");
+	scriptCache_.clear();
+
+	// 新增的脚本在此加入, 工作线程已结束, 可以修改usage_
+	supportedTypes_.clear();
+	scanScriptDirectory(scriptDir_);
+	for (const auto& type : supportedTypes_)
+		usage_.try_emplace(type);
+}
+
 // 获取指定的section字典
 PyObject* CustomChecker::py_get_section(PyObject* self, PyObject* args) {
 	const char* name;
@@ -69,20 +214,15 @@ PyObject* CustomChecker::py_get_section(PyObject* self, PyObject* args) {
 	}
 
 	try {
-		// 获取 Section
-		auto it = globalSections_.find(std::string(name));
-		if (it == globalSections_.end()) {
+		// 获取 Section, 返回的是直接引用targetIni的只读映射
+		PyObject* section = IniView::getSection(std::string(name));
+		if (!section) {
+			if (PyErr_Occurred())
+				return nullptr;
 			Log::out("找不到section[{}]: ", name);
 			return PyDict_New();
 		}
-
-		PyObject* pyDict = PyDict_New();
-		for (const auto& [key, value] : it->second.section) {
-			PyObject* pyValue = PyUnicode_FromString(value.value.c_str());
-			PyDict_SetItemString(pyDict, key.c_str(), pyValue);
-			Py_DECREF(pyValue);
-		}
-		return pyDict;
+		return Py_NewRef(section);
 	}
 	catch (const std::exception& e) {
 		Log::out("获取section[{}]失败，错误信息: ", name, e.what());
@@ -104,25 +244,27 @@ PyObject* CustomChecker::py_get_section_value(PyObject* self, PyObject* args) {
 
 	try {
 		// 获取指定的 Section
-		auto sectionIt = globalSections_.find(std::string(sectionName));
-		if (sectionIt == globalSections_.end()) {
+		PyObject* section = IniView::getSection(std::string(sectionName));
+		if (!section) {
+			if (PyErr_Occurred())
+				return nullptr;
 			Log::out("找不到section[{}]: ", sectionName);
 			Py_RETURN_NONE;  // 如果 Section 不存在，返回 None
 		}
 
-		const Section& section = sectionIt->second;
-
-		// 获取指定 Key 的 Value
-		auto valueIt = section.section.find(std::string(keyName));
-		if (valueIt == section.section.end()) {
+		// 获取指定 Key 的 Value, 值字符串由节对象缓存
+		PyObject* key = PyUnicode_FromString(keyName);
+		PyObject* value = key ? IniView::getValue(section, key) : nullptr;
+		Py_XDECREF(key);
+		if (!value) {
+			if (PyErr_Occurred())
+				return nullptr;
 			Log::out("找不到key[{}] in section[{}]: ", keyName, sectionName);
 			Py_RETURN_NONE;  // 如果 Key 不存在，返回 None
 		}
 
-		const Value& value = valueIt->second;
-
 		// 返回 Value 的字符串值
-		return PyUnicode_FromString(value.value.c_str());
+		return Py_NewRef(value);
 	}
 	catch (const std::exception& e) {
 		Log::out("获取section[{}]和key[{}]失败，错误信息: ", sectionName, keyName, e.what());
@@ -167,6 +309,14 @@ std::shared_ptr<CustomChecker::Script> CustomChecker::getOrLoadScript(const std:
 		return nullptr;
 	}
 
+	auto script = loadScript(type);
+	if (script)
+		scriptCache_[type] = script;
+	return script;
+}
+
+// 在当前解释器中导入脚本, report为false时失败不输出日志
+std::shared_ptr<CustomChecker::Script> CustomChecker::loadScript(const std::string& type, bool report) {
 	// 获取当前工作目录并拼接 Scripts 子目录
 	std::filesystem::path script_dir = std::filesystem::current_path() / "Scripts";
 
@@ -178,21 +328,30 @@ std::shared_ptr<CustomChecker::Script> CustomChecker::getOrLoadScript(const std:
 
 	PyObject* pModule = PyImport_ImportModule(type.c_str());
 	if (!pModule) {
-		Log::out("加载脚本失败: {}", type);
+		PyErr_Clear();
+		if (report)
+			Log::out("加载脚本失败: {}", type);
 		return nullptr;
 	}
 
 	PyObject* pFunc = PyObject_GetAttrString(pModule, "validate");
 	if (!pFunc || !PyCallable_Check(pFunc)) {
+		PyErr_Clear();
 		Py_XDECREF(pFunc);
 		Py_XDECREF(pModule);
-		Log::out("无法在脚本中找到\"validate\"函数或者函数无法被调用: {}", type);
+		if (report)
+			Log::out("无法在脚本中找到\"validate\"函数或者函数无法被调用: {}", type);
 		return nullptr;
 	}
 
-	auto script = std::make_shared<Script>(pModule, pFunc);
-	scriptCache_[type] = script;
-	return script;
+	// validate_batch是可选的, 定义后该脚本的所有键值在遍历结束后分批一次性传入
+	PyObject* pBatch = PyObject_GetAttrString(pModule, "validate_batch");
+	if (!pBatch || !PyCallable_Check(pBatch)) {
+		PyErr_Clear();
+		Py_CLEAR(pBatch);
+	}
+
+	return std::make_shared<Script>(pModule, pFunc, pBatch, type);
 }
 
 // 扫描脚本目录，初始化支持的脚本类型
@@ -209,56 +368,479 @@ void CustomChecker::scanScriptDirectory(const std::string& path) {
 	}
 }
 
+// 准备一次调用的参数(section, key, value, type)
+// 节对象和其中的值都是缓存的, 只有键名需要新建
+// 列表检查器传入的是列表中的单个元素, 与节中的值不同时才新建字符串
+PyObject* CustomChecker::makeArgs(const Script& script, const Section& section, const std::string& key, const std::string& value) {
+	PyObject* pySection = IniView::getSection(section); // borrowed reference
+	if (!pySection)
+		return nullptr;
+	PyObject* pyKey = PyUnicode_FromString(key.c_str());
+	PyObject* pyValue = pyKey ? IniView::getValue(pySection, pyKey) : nullptr; // borrowed reference
+	Py_ssize_t size = 0;
+	const char* cached = pyValue ? PyUnicode_AsUTF8AndSize(pyValue, &size) : nullptr;
+	if (cached && std::string_view(cached, size) == value)
+		Py_INCREF(pyValue);
+	else
+		pyValue = PyUnicode_FromString(value.c_str());
+
+	PyObject* pArgs = pyKey && pyValue ? PyTuple_Pack(4, pySection, pyKey, pyValue, script.type) : nullptr;
+	Py_XDECREF(pyValue);
+	Py_XDECREF(pyKey);
+	return pArgs;
+}
+
+// 解析单个结果并输出日志
+void CustomChecker::handleResult(PyObject* pResult, const Section& section, const std::string& key, const std::string& type) {
+	if (!PyTuple_Check(pResult) || PyTuple_Size(pResult) != 2)
+		return Log::out("Python函数必须返回一个(int, string)的元组类型: {}", type);
+
+	PyObject* pCode = PyTuple_GetItem(pResult, 0);
+	PyObject* pMessage = PyTuple_GetItem(pResult, 1);
+
+	if (!PyUnicode_Check(pMessage) || !PyLong_Check(pCode))
+		return Log::out("Python函数必须返回一个(int, string)的元组类型: {}", type);
+
+	reportResult(pMessage, pCode, section, key);
+}
+
 // 验证函数
+// 定义了validate_batch的脚本只记录待检查的键值, 攒满一批或遍历结束时再统一调用
+// 并行检查时所有脚本都先记录下来, 遍历结束后分给各个子解释器
 void CustomChecker::validate(const Section& section, const std::string& key, const Value& value, const std::string& type) {
+	Profiler::Scope profile(Profiler::Category::Checker, "CustomChecker");
 	try {
 		auto script = getOrLoadScript(type);
 		if (!script || !script->func)
 			return;
 
-		// 转换 Section 为 Python 字典
-		PyObject* pySection = PyDict_New();
-		for (const auto& [k, v] : section.section) {
-			PyObject* pyKey = PyUnicode_FromString(k.c_str());
-			PyObject* pyValue = PyUnicode_FromString(v.value.c_str());
-			PyDict_SetItem(pySection, pyKey, pyValue);
-			Py_XDECREF(pyKey);
-			Py_XDECREF(pyValue);
+		if (!script->batch && workers_ <= 1)
+			return call(*script, section, key, value.value, type);
+
+		auto& pending = pending_[type];
+		pending.push_back({ &section, key, value.value });
+		if (workers_ <= 1 && pending.size() >= BatchSize) {
+			run(*script, type, pending);
+			pending.clear();
 		}
+	}
+	catch (const std::exception& e) {
+		Log::out("自定义检查器出现错误: {}", e.what());
+	}
+}
+
+// 包含count项的一次调用的时限: 按项数累加ScriptTimeout, 但最多比ScriptTimeout多出BatchTimeoutMargin
+// 否则一批4096项的调用可能要运行一个多小时才被中断; 为0时不限制
+std::chrono::milliseconds CustomChecker::callTimeout(size_t count) {
+	auto timeout = std::chrono::milliseconds(Settings::Instance->scriptTimeout);
+	if (timeout.count() == 0)
+		return timeout;
+	return (std::min)(timeout * static_cast<long long>(count), timeout + BatchTimeoutMargin);
+}
 
-		// 准备参数
-		PyObject* pArgs = PyTuple_Pack(4,
-									   pySection,
-									   PyUnicode_FromString(key.c_str()),
-									   PyUnicode_FromString(value.value.c_str()),
-									   PyUnicode_FromString(type.c_str()));
+// 在Watchdog的监视下调用脚本, count为本次调用包含的键值数量, 批量调用超时时记在第一项上
+// 单次期限为callTimeout(count), 且不超过该脚本剩余的预算; 因超时被中断时清除TimeoutError并返回nullptr
+PyObject* CustomChecker::invoke(PyObject* func, PyObject* args, const std::string& type, size_t count, const Section& section, const std::string& key) {
+	using namespace std::chrono;
+	auto& usage = usage_.at(type);
+	auto timeout = callTimeout(count);
+	auto budget = milliseconds(Settings::Instance->scriptBudget);
+	auto limit = timeout;
+	if (budget.count() > 0) {
+		auto remaining = budget - duration_cast<milliseconds>(microseconds(usage.elapsed.load()));
+		remaining = (std::max)(remaining, milliseconds(1));
+		limit = limit.count() > 0 ? (std::min)(limit, remaining) : remaining;
+	}
 
-		// 调用 Python 函数
-		PyObject* pResult = PyObject_CallObject(script->func, pArgs);
-		Py_XDECREF(pArgs);
+	auto start = steady_clock::now();
+	PyObject* result;
+	{
+		Watchdog::Guard guard(watchdog_, limit);
+		result = PyObject_CallObject(func, args);
+	}
+	auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+	auto total = microseconds(usage.elapsed += elapsed.count());
 
-		if (!pResult)
-			return Log::out("Python函数调用失败: {}", type);
+	bool expired = false;
+	if (timeout.count() > 0 && elapsed >= timeout) {
+		expired = true;
+		Log::error<_CustomCheckerTimeout>({ section, key }, type, elapsed.count() / 1000, timeout.count(), total.count() / 1000);
+	}
+	if (budget.count() > 0 && total >= budget) {
+		expired = true;
+		if (!usage.exhausted.exchange(true))
+			Log::error<_CustomCheckerBudgetExceeded>({ section, key }, type, total.count() / 1000, budget.count());
+	}
+	if (!result && expired && PyErr_ExceptionMatches(PyExc_TimeoutError))
+		PyErr_Clear();
+	return result;
+}
 
-		// 解析结果
-		if (!PyTuple_Check(pResult) || PyTuple_Size(pResult) != 2) {
-			Py_XDECREF(pResult);
-			return Log::out("Python函数必须返回一个(int, string)的元组类型: {}", type);
+bool CustomChecker::exhausted(const std::string& type) const {
+	auto it = usage_.find(type);
+	return it != usage_.end() && it->second.exhausted.load(std::memory_order_relaxed);
+}
+
+// 逐项调用validate
+void CustomChecker::call(const Script& script, const Section& section, const std::string& key, const std::string& value, const std::string& type) {
+	if (exhausted(type))
+		return;
+	Profiler::Scope profileScript(Profiler::Category::Script, type);
+	PyObject* pArgs = makeArgs(script, section, key, value);
+	if (!pArgs) {
+		PyErr_Clear();
+		return Log::out("Python函数调用失败: {}", type);
+	}
+
+	// 调用 Python 函数
+	PyObject* pResult = invoke(script.func, pArgs, type, 1, section, key);
+	Py_XDECREF(pArgs);
+
+	if (!pResult) {
+		if (!PyErr_Occurred())
+			return;
+		PyErr_Clear();
+		return Log::out("Python函数调用失败: {}", type);
+	}
+
+	handleResult(pResult, section, key, type);
+	Py_XDECREF(pResult);
+}
+
+// 按BatchSize分批, 子解释器或工作进程可用时并行执行, 剩余的批次在主解释器中顺序执行
+// 并行执行的批次按原来的顺序输出日志, 同一行的日志不会因为批次完成的先后而改变顺序
+void CustomChecker::flush() {
+	std::vector<Batch> batches;
+	for (auto& [type, items] : pending_) {
+		size_t size = BatchSize;
+		if (workers_ > 1)
+			size = std::clamp((items.size() + workers_ - 1) / workers_, MinBatchSize, BatchSize);
+		for (size_t begin = 0; begin < items.size(); begin += size) {
+			auto first = items.begin() + begin;
+			auto last = items.begin() + std::min(items.size(), begin + size);
+			batches.push_back({ type, { std::make_move_iterator(first), std::make_move_iterator(last) } });
 		}
+	}
+	pending_.clear();
+
+	if (workers_ > 1 && batches.size() > 1)
+		runParallel(batches);
+	for (auto& batch : batches) {
+		if (batch.done)
+			Log::replay(batch.logs);
+		else if (auto script = getOrLoadScript(batch.type))
+			run(*script, batch.type, batch.items);
+	}
+}
 
-		PyObject* pCode = PyTuple_GetItem(pResult, 0);
-		PyObject* pMessage = PyTuple_GetItem(pResult, 1);
+// 以列表的形式一次性传入所有待检查的键值, 返回的列表与传入的顺序一一对应
+// 未定义validate_batch的脚本逐项调用validate
+void CustomChecker::run(const Script& script, const std::string& type, const std::vector<Item>& items) {
+	if (items.empty() || exhausted(type))
+		return;
+	if (!script.batch) {
+		for (const auto& item : items)
+			call(script, *item.section, item.key, item.value, type);
+		return;
+	}
 
-		if (!PyUnicode_Check(pMessage) || !PyLong_Check(pCode)) {
-			Py_XDECREF(pResult);
-			return Log::out("Python函数必须返回一个(int, string)的元组类型: {}", type);
+	Profiler::Scope profileScript(Profiler::Category::Script, type);
+	PyObject* pItems = PyList_New(0);
+	for (const auto& item : items) {
+		PyObject* pArgs = makeArgs(script, *item.section, item.key, item.value);
+		if (!pArgs || PyList_Append(pItems, pArgs) < 0) {
+			PyErr_Clear();
+			Py_XDECREF(pArgs);
+			Py_DECREF(pItems);
+			return Log::out("Python函数调用失败: {}", type);
 		}
+		Py_DECREF(pArgs);
+	}
 
-		reportResult(pMessage, pCode, section, key);
+	PyObject* pArgs = PyTuple_Pack(1, pItems);
+	Py_DECREF(pItems);
+	PyObject* pResult = pArgs ? invoke(script.batch, pArgs, type, items.size(), *items.front().section, items.front().key) : nullptr;
+	Py_XDECREF(pArgs);
+	if (!pResult) {
+		if (!PyErr_Occurred())
+			return;
+		PyErr_Clear();
+		return Log::out("Python函数调用失败: {}", type);
+	}
 
-		Py_XDECREF(pResult);
+	PyObject* pList = PySequence_Fast(pResult, "");
+	Py_DECREF(pResult);
+	if (!pList || PySequence_Fast_GET_SIZE(pList) != static_cast<Py_ssize_t>(items.size())) {
+		PyErr_Clear();
+		Py_XDECREF(pList);
+		return Log::out("validate_batch必须返回与输入等长的(int, string)元组列表: {}", type);
 	}
-	catch (const std::exception& e) {
-		Log::out("自定义检查器出现错误: {}", e.what());
+
+	PyObject** results = PySequence_Fast_ITEMS(pList);
+	for (size_t i = 0; i < items.size(); ++i)
+		handleResult(results[i], *items[i].section, items[i].key, type);
+	Py_DECREF(pList);
+}
+
+// 把批次分发给工作线程, 每个线程在自己的子解释器或工作进程中领取批次, 全部完成后返回
+// 目标ini在检查期间只读, 子解释器通过iv直接读取, 不需要序列化节数据; 工作进程在每次attach后收到一份副本
+// 子解释器或工作进程创建失败、脚本不支持子解释器时, 对应的批次留给主解释器执行
+void CustomChecker::runParallel(std::vector<Batch>& batches) {
+	PyInterpreterState* mainInterp = PyInterpreterState_Get();
+#ifndef IV_SUBINTERPRETERS
+	if (target_ && snapshotVersion_ != attached_) {
+		snapshot_ = encodeIni(*target_);
+		snapshotVersion_ = attached_;
+	}
+#endif
+	Py_BEGIN_ALLOW_THREADS
+	std::unique_lock<std::mutex> lock(poolMutex_);
+	while (pool_.size() < workers_)
+		pool_.emplace_back(&CustomChecker::runWorker, this, mainInterp);
+	job_ = &batches;
+	next_ = 0;
+	running_ = pool_.size();
+	++generation_;
+	poolChanged_.notify_all();
+	poolChanged_.wait(lock, [this] { return running_ == 0; });
+	job_ = nullptr;
+	lock.unlock();
+	Py_END_ALLOW_THREADS
+}
+
+// 结束所有工作线程, 线程结束子解释器时需要主解释器的GIL
+void CustomChecker::stopWorkers() {
+	if (pool_.empty())
+		return;
+	Py_BEGIN_ALLOW_THREADS
+	{
+		std::lock_guard<std::mutex> lock(poolMutex_);
+		stopping_ = true;
+	}
+	poolChanged_.notify_all();
+	for (auto& thread : pool_)
+		thread.join();
+	Py_END_ALLOW_THREADS
+	pool_.clear();
+}
+
+void CustomChecker::runWorker(PyInterpreterState* mainInterp) {
+	size_t generation = 0;
+	PyThreadState* mainState = nullptr;
+	PyThreadState* state = nullptr;
+	std::unordered_map<std::string, std::shared_ptr<Script>> scripts;
+	std::unique_ptr<WorkerProcess> process;
+	size_t sent = 0;	// 工作进程中的ini副本对应的attach次数
+
+#ifdef IV_SUBINTERPRETERS
+	// 子解释器要在持有主解释器GIL时创建, 创建后主解释器的GIL被释放, 改为持有子解释器自己的GIL
+	mainState = PyThreadState_New(mainInterp);
+	PyEval_RestoreThread(mainState);
+
+	PyInterpreterConfig config = {
+		.use_main_obmalloc = 0,
+		.allow_fork = 0,
+		.allow_exec = 0,
+		.allow_threads = 1,
+		.allow_daemon_threads = 0,
+		.check_multi_interp_extensions = 1,
+		.gil = PyInterpreterConfig_OWN_GIL,
+	};
+	PyStatus status = Py_NewInterpreterFromConfig(&state, &config);
+	if (PyStatus_Exception(status)) {
+		Log::out("创建Python子解释器失败: {}", status.err_msg ? status.err_msg : "");
+		PyThreadState_Clear(mainState);
+		PyThreadState_DeleteCurrent();
+		mainState = state = nullptr;
+	}
+	else if (PyRun_SimpleString("import iv") != 0) {
+		Py_EndInterpreter(state);
+		PyEval_RestoreThread(mainState);
+		PyThreadState_Clear(mainState);
+		PyThreadState_DeleteCurrent();
+		mainState = state = nullptr;
+	}
+	else
+		PyEval_SaveThread();
+#else
+	// 工作线程不持有GIL, 只负责与自己的工作进程交换消息
+	process = WorkerProcess::start();
+	if (!process)
+		Log::out("启动Python工作进程失败");
+#endif
+
+	// 无法使用子解释器或工作进程的线程不领取批次, 只参与完成计数
+	std::unique_lock<std::mutex> lock(poolMutex_);
+	while (true) {
+		poolChanged_.wait(lock, [&] { return stopping_ || generation_ != generation; });
+		if (stopping_)
+			break;
+		generation = generation_;
+		auto& batches = *job_;
+		lock.unlock();
+
+		if (state) {
+			PyEval_RestoreThread(state);
+			for (size_t i; (i = next_++) < batches.size();) {
+				auto& batch = batches[i];
+				if (!scripts.contains(batch.type))
+					scripts[batch.type] = loadScript(batch.type, false);
+				if (auto& script = scripts[batch.type]) {
+					Log::Capture capture(batch.logs, false);
+					run(*script, batch.type, batch.items);
+					batch.done = true;
+				}
+			}
+			IniView::clear();
+			PyEval_SaveThread();
+		}
+		// 与工作进程的通信失败时不再领取批次, 未完成的批次由主解释器执行
+		for (size_t i; process && (i = next_++) < batches.size();)
+			if (!runRemote(*process, sent, batches[i]))
+				process.reset();
+
+		lock.lock();
+		if (--running_ == 0)
+			poolChanged_.notify_all();
+	}
+	lock.unlock();
+
+	if (state) {
+		PyEval_RestoreThread(state);
+		scripts.clear();
+		Py_EndInterpreter(state);
+		PyEval_RestoreThread(mainState);
+		PyThreadState_Clear(mainState);
+		PyThreadState_DeleteCurrent();
+	}
+}
+
+// 把批次发给工作进程执行, 已用尽预算的脚本直接跳过; 返回false表示管道已断开、回复不完整或工作进程已被结束
+// 脚本的累计耗时随批次发给工作进程, 执行后再把增加的部分加回usage_, 多个进程同时执行同一脚本时只保留第一条超出预算的日志
+// 工作进程中的调用由它自己的Watchdog中断; 停留在原生代码中或死锁时, 超过ScriptTimeout*项数(且不超过剩余预算)再加RemoteTimeoutMargin
+// 仍没有回复就结束该进程, 以CustomCheckerTimeout报告整个批次
+bool CustomChecker::runRemote(WorkerProcess& process, size_t& sent, Batch& batch) {
+	using namespace std::chrono;
+	if (sent != attached_) {
+		if (!process.send(snapshot_))
+			return false;
+		sent = attached_;
+	}
+	auto& usage = usage_.at(batch.type);
+	if (usage.exhausted) {
+		batch.done = true;
+		return true;
+	}
+
+	std::string message = "B";
+	writeString(message, batch.type);
+	write<long long>(message, usage.elapsed);
+	write<uint64_t>(message, batch.items.size());
+	for (const auto& item : batch.items) {
+		writeString(message, item.section->name);
+		writeString(message, item.key);
+		writeString(message, item.value);
+	}
+	auto limit = milliseconds(Settings::Instance->scriptTimeout * batch.items.size());
+	if (auto budget = milliseconds(Settings::Instance->scriptBudget); budget.count() > 0) {
+		auto remaining = (std::max)(budget - duration_cast<milliseconds>(microseconds(usage.elapsed.load())), milliseconds(1));
+		limit = limit.count() > 0 ? (std::min)(limit, remaining) : remaining;
+	}
+	if (limit.count() > 0)
+		limit += RemoteTimeoutMargin;
+
+	std::string reply;
+	auto start = steady_clock::now();
+	if (!process.send(message) || !process.receive(reply, limit)) {
+		if (!process.expired())
+			return false;
+		process.terminate();
+		auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+		auto total = microseconds(usage.elapsed += elapsed.count());
+		const auto& item = batch.items.front();
+		Log::Capture capture(batch.logs, false);
+		Log::error<_CustomCheckerTimeout>({ *item.section, item.key }, batch.type, elapsed.count() / 1000, limit.count(), total.count() / 1000);
+		batch.done = true;
+		return false;
+	}
+
+	try {
+		binary::Reader reader(reply);
+		// 工作进程无法导入脚本时由主解释器执行, 以便输出加载失败的日志
+		if (!reader.read<uint8_t>())
+			return true;
+		usage.elapsed += reader.read<long long>();
+		bool exhausted = reader.read<uint8_t>();
+		batch.logs = decodeLogs(reader);
+		if (exhausted && usage.exhausted.exchange(true))
+			std::erase_if(batch.logs, [](const LogEntry& log) { return log.rule == LogRule::CustomCheckerBudgetExceeded; });
+		batch.done = true;
+		return true;
+	}
+	catch (const std::out_of_range&) {
+		return false;
+	}
+}
+
+// 工作进程中的检查器只在主解释器中顺序执行, 日志只记录不输出, 随回复发回父进程
+int CustomChecker::serve(WorkerProcess& parent) {
+	Log log;
+	Settings settings(IniFile("Settings.ini", true));
+	CustomChecker checker("Scripts");
+	checker.workers_ = 1;
+	if (!Py_IsInitialized())
+		return 1;
+
+	auto ini = std::make_unique<IniFile>();
+	std::unordered_map<std::string, std::shared_ptr<Script>> scripts;
+	std::string message;
+	while (parent.receive(message)) {
+		std::string reply;
+		try {
+			binary::Reader reader(message);
+			if (reader.read<char>() == 'I') {
+				auto next = std::make_unique<IniFile>();
+				decodeIni(reader, *next);
+				checker.attach(*next);
+				ini = std::move(next);
+				continue;
+			}
+
+			auto type = reader.readString();
+			auto elapsed = reader.read<long long>();
+			std::vector<Item> items;
+			for (auto count = reader.read<uint64_t>(); count > 0; --count) {
+				auto section = reader.readString();
+				auto key = reader.readString();
+				auto value = reader.readString();
+				if (auto it = ini->sections.find(section); it != ini->sections.end())
+					items.push_back({ &it->second, std::move(key), std::move(value) });
+			}
+
+			if (!scripts.contains(type))
+				scripts[type] = checker.supportedTypes_.contains(type) ? checker.loadScript(type, false) : nullptr;
+			auto& script = scripts[type];
+			write<uint8_t>(reply, script != nullptr);
+			if (script) {
+				auto& usage = checker.usage_.at(type);
+				usage.elapsed = elapsed;
+				usage.exhausted = false;
+				std::vector<LogEntry> logs;
+				{
+					Log::Capture capture(logs, false);
+					checker.run(*script, type, items);
+				}
+				write<long long>(reply, usage.elapsed - elapsed);
+				write<uint8_t>(reply, usage.exhausted);
+				encodeLogs(reply, logs);
+			}
+		}
+		catch (const std::out_of_range&) {
+			break;
+		}
+		if (!parent.send(reply))
+			break;
 	}
+	scripts.clear();
+	return 0;
 }
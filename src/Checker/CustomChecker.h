@@ -1,24 +1,37 @@
 ﻿#pragma once
 #include "IniFile.h"
+#include "Log.h"
+#include "Watchdog.h"
 #include <Python.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <filesystem>
 
+class WorkerProcess;
 class CustomChecker {
 public:
-	explicit CustomChecker(const std::string& scriptDir, const IniFile& targetIni);
+	explicit CustomChecker(const std::string& scriptDir);
 	~CustomChecker();
 
+	void attach(const IniFile& targetIni); // 开始检查targetIni, 每次检查前调用, 已导入的脚本保持不变
+	void reload(); // 脚本文件改变后调用, 之后的检查重新导入脚本
 	void reportResult(PyObject* pMessage, PyObject* pCode, const Section& section, const std::string& key);
 	void validate(const Section& section, const std::string& key, const Value& value, const std::string& type);
+	void flush(); // 执行所有尚未提交的批量检查
 	bool contains(const std::string& type) const {
 		return supportedTypes_.contains(type);
 	}
 
+	static int serve(WorkerProcess& parent); // 工作进程的入口, 接收目标ini的副本和批次, 返回检查产生的日志, 直到父进程关闭管道
+
 	static PyObject* py_get_section(PyObject* self, PyObject* args);
 	static PyObject* py_get_section_value(PyObject* self, PyObject* args);
 
@@ -27,17 +40,76 @@ private:
 	struct Script {
 		PyObject* module; // Python 模块
 		PyObject* func; // validate 函数指针
+		PyObject* batch; // validate_batch 函数指针, 脚本未定义时为空
+		PyObject* type; // 类型名, 每次调用时作为参数传入
 
-		Script(PyObject* mod, PyObject* func);
+		Script(PyObject* mod, PyObject* func, PyObject* batch, const std::string& type);
 		~Script();
 	};
 
-	static std::unordered_map<std::string, Section> globalSections_;		// 全局Section存储
+	// 等待检查的键值, 值可能是列表中的单个元素, 因此单独保存
+	struct Item {
+		const Section* section;
+		std::string key;
+		std::string value;
+	};
 
+	// 同一脚本的一批键值, 并行检查时是分给子解释器或工作进程的最小单位
+	// 并行检查的日志先记录在批次中, 全部完成后按批次顺序输出, 与执行的线程无关
+	struct Batch {
+		std::string type;
+		std::vector<Item> items;
+		bool done{ false };
+		std::vector<LogEntry> logs;
+	};
+
+	// 脚本在所有线程中的累计耗时
+	struct Usage {
+		std::atomic<long long> elapsed{ 0 };	// 微秒
+		std::atomic<bool> exhausted{ false };	// 已超出ScriptBudget, 其余检查跳过
+	};
+
+	static constexpr size_t BatchSize = 4096; // 每批最多的键值数量
+	static constexpr size_t MinBatchSize = 64; // 并行检查时每批最少的键值数量
+	static constexpr std::chrono::milliseconds BatchTimeoutMargin{ 60000 }; // 批量调用的时限最多比单次时限多出的时间
+	static constexpr std::chrono::milliseconds RemoteTimeoutMargin{ 10000 }; // 等待工作进程回复时在脚本时限之外多等的时间
+
+	size_t workers_{ 1 };													// 并行检查的子解释器或工作进程数量, 为1时在主解释器中顺序检查
+	std::unordered_map<std::string, std::vector<Item>> pending_;			// 等待检查的键值, 按脚本类型分组
 	std::string scriptDir_;													// 脚本目录
 	std::unordered_map<std::string, std::shared_ptr<Script>> scriptCache_;	// 缓存已加载的脚本
 	std::unordered_set<std::string> supportedTypes_;						// 支持的脚本类型集合
+	std::unordered_map<std::string, Usage> usage_;							// 各脚本的累计耗时, 只在没有工作线程时增加, 不删除
+	Watchdog watchdog_;														// 中断超时的脚本调用
+	const IniFile* target_{ nullptr };										// 正在检查的ini
+	size_t attached_{ 0 };													// attach的次数, 工作进程据此判断ini副本是否过期
+	std::string snapshot_;													// 发给工作进程的ini副本, 每次attach后第一次并行检查时生成
+	size_t snapshotVersion_{ 0 };
+
+	// 常驻的工作线程, 第一次并行检查时启动, 直到析构才结束
+	// Python 3.12及以上每个线程拥有一个子解释器, 否则每个线程启动一个工作进程, 脚本在每个子解释器或进程中只导入一次
+	std::vector<std::thread> pool_;
+	std::mutex poolMutex_;
+	std::condition_variable poolChanged_;
+	std::vector<Batch>* job_{ nullptr };									// 正在分发的批次
+	std::atomic<size_t> next_{ 0 };											// 下一个待领取的批次
+	size_t generation_{ 0 };												// 每分发一次加一
+	size_t running_{ 0 };													// 尚未处理完本次批次的工作线程数
+	bool stopping_{ false };
 
 	std::shared_ptr<Script> getOrLoadScript(const std::string& type); 
+	std::shared_ptr<Script> loadScript(const std::string& type, bool report = true);
+	PyObject* makeArgs(const Script& script, const Section& section, const std::string& key, const std::string& value);
+	void handleResult(PyObject* pResult, const Section& section, const std::string& key, const std::string& type);
+	static std::chrono::milliseconds callTimeout(size_t count);
+	PyObject* invoke(PyObject* func, PyObject* args, const std::string& type, size_t count, const Section& section, const std::string& key);
+	bool exhausted(const std::string& type) const;
+	void call(const Script& script, const Section& section, const std::string& key, const std::string& value, const std::string& type);
+	void run(const Script& script, const std::string& type, const std::vector<Item>& items);
+	void runParallel(std::vector<Batch>& batches);
+	void runWorker(PyInterpreterState* mainInterp);
+	bool runRemote(WorkerProcess& process, size_t& sent, Batch& batch);
+	void stopWorkers();
+
 	void scanScriptDirectory(const std::string& path);
 };
\ No newline at end of file
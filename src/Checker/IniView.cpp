@@ -0,0 +1,319 @@
+﻿#include "IniView.h"
+#include <format>
+
+const IniFile* IniView::Target = nullptr;
+thread_local IniView::State* IniView::Current = nullptr;
+
+namespace {
+	struct SectionObject {
+		PyObject_HEAD
+		const Section* section;	// 为空代表已失效
+		PyObject* values;		// 已转换的键值, 全部转换后complete为true
+		bool complete;
+	};
+
+	SectionObject* checkSection(PyObject* self) {
+		auto object = reinterpret_cast<SectionObject*>(self);
+		if (!object->section) {
+			PyErr_SetString(PyExc_RuntimeError, "节已失效, 不能在检查结束后继续使用");
+			return nullptr;
+		}
+		return object;
+	}
+
+	// 转换单个值并缓存, 返回借用引用, 键不存在时返回nullptr且不设置异常
+	// 节名和键名不区分大小写, 缓存以ini中的原始键名为键, 与keys()的结果一致
+	PyObject* sectionValue(SectionObject* object, PyObject* key) {
+		if (auto value = PyDict_GetItemWithError(object->values, key))
+			return value;
+		if (PyErr_Occurred())
+			return nullptr;
+
+		const char* name = PyUnicode_AsUTF8(key);
+		if (!name)
+			return nullptr;
+		auto it = object->section->section.find(name);
+		if (it == object->section->section.end())
+			return nullptr;
+		if (auto value = PyDict_GetItemString(object->values, it->first.c_str()))
+			return value;
+		if (object->complete)
+			return nullptr;
+
+		PyObject* value = PyUnicode_FromStringAndSize(it->second.value.data(), it->second.value.size());
+		if (!value || PyDict_SetItemString(object->values, it->first.c_str(), value) < 0) {
+			Py_XDECREF(value);
+			return nullptr;
+		}
+		Py_DECREF(value);
+		return value;
+	}
+
+	// 转换所有值, 供keys/values/items/迭代使用
+	bool completeSection(SectionObject* object) {
+		if (object->complete)
+			return true;
+		for (const auto& [key, value] : object->section->section) {
+			PyObject* pyValue = PyUnicode_FromStringAndSize(value.value.data(), value.value.size());
+			if (!pyValue || PyDict_SetItemString(object->values, key.c_str(), pyValue) < 0) {
+				Py_XDECREF(pyValue);
+				return false;
+			}
+			Py_DECREF(pyValue);
+		}
+		object->complete = true;
+		return true;
+	}
+
+	void sectionDealloc(PyObject* self) {
+		auto object = reinterpret_cast<SectionObject*>(self);
+		auto type = Py_TYPE(self);
+		Py_XDECREF(object->values);
+		type->tp_free(self);
+		Py_DECREF(type);
+	}
+
+	Py_ssize_t sectionLength(PyObject* self) {
+		auto object = checkSection(self);
+		return object ? static_cast<Py_ssize_t>(object->section->section.size()) : -1;
+	}
+
+	PyObject* sectionSubscript(PyObject* self, PyObject* key) {
+		auto object = checkSection(self);
+		if (!object)
+			return nullptr;
+		if (!PyUnicode_Check(key)) {
+			PyErr_SetObject(PyExc_KeyError, key);
+			return nullptr;
+		}
+		PyObject* value = sectionValue(object, key);
+		if (!value && !PyErr_Occurred())
+			PyErr_SetObject(PyExc_KeyError, key);
+		return Py_XNewRef(value);
+	}
+
+	int sectionContains(PyObject* self, PyObject* key) {
+		auto object = checkSection(self);
+		if (!object)
+			return -1;
+		if (!PyUnicode_Check(key))
+			return 0;
+		const char* name = PyUnicode_AsUTF8(key);
+		return name ? object->section->section.contains(name) : -1;
+	}
+
+	PyObject* sectionIter(PyObject* self) {
+		auto object = checkSection(self);
+		if (!object || !completeSection(object))
+			return nullptr;
+		return PyObject_GetIter(object->values);
+	}
+
+	PyObject* sectionKeys(PyObject* self, PyObject*) {
+		auto object = checkSection(self);
+		return object && completeSection(object) ? PyDict_Keys(object->values) : nullptr;
+	}
+
+	PyObject* sectionValues(PyObject* self, PyObject*) {
+		auto object = checkSection(self);
+		return object && completeSection(object) ? PyDict_Values(object->values) : nullptr;
+	}
+
+	PyObject* sectionItems(PyObject* self, PyObject*) {
+		auto object = checkSection(self);
+		return object && completeSection(object) ? PyDict_Items(object->values) : nullptr;
+	}
+
+	PyObject* sectionGet(PyObject* self, PyObject* args) {
+		PyObject* key;
+		PyObject* defaultValue = Py_None;
+		if (!PyArg_ParseTuple(args, "O|O", &key, &defaultValue))
+			return nullptr;
+		auto object = checkSection(self);
+		if (!object)
+			return nullptr;
+		PyObject* value = PyUnicode_Check(key) ? sectionValue(object, key) : nullptr;
+		if (PyErr_Occurred())
+			return nullptr;
+		return Py_NewRef(value ? value : defaultValue);
+	}
+
+	PyObject* sectionName(PyObject* self, void*) {
+		auto object = checkSection(self);
+		return object ? PyUnicode_FromString(object->section->name.c_str()) : nullptr;
+	}
+
+	PyObject* sectionRepr(PyObject* self) {
+		auto object = reinterpret_cast<SectionObject*>(self);
+		if (!object->section)
+			return PyUnicode_FromString("<iv.Section (已失效)>");
+		auto repr = std::format("<iv.Section [{}], {}个键>", object->section->name, object->section->section.size());
+		return PyUnicode_FromStringAndSize(repr.data(), repr.size());
+	}
+
+	PyMethodDef sectionMethods[] = {
+		{"keys",	sectionKeys,	METH_NOARGS,	"所有键"},
+		{"values",	sectionValues,	METH_NOARGS,	"所有值"},
+		{"items",	sectionItems,	METH_NOARGS,	"所有键值对"},
+		{"get",		sectionGet,		METH_VARARGS,	"获取键的值, 不存在时返回默认值"},
+		{nullptr, nullptr, 0, nullptr}
+	};
+
+	PyGetSetDef sectionGetSet[] = {
+		{"name", sectionName, nullptr, "节名", nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr}
+	};
+
+	PyType_Slot sectionSlots[] = {
+		{Py_tp_dealloc,		reinterpret_cast<void*>(sectionDealloc)},
+		{Py_tp_repr,		reinterpret_cast<void*>(sectionRepr)},
+		{Py_tp_iter,		reinterpret_cast<void*>(sectionIter)},
+		{Py_tp_methods,		sectionMethods},
+		{Py_tp_getset,		sectionGetSet},
+		{Py_mp_length,		reinterpret_cast<void*>(sectionLength)},
+		{Py_mp_subscript,	reinterpret_cast<void*>(sectionSubscript)},
+		{Py_sq_contains,	reinterpret_cast<void*>(sectionContains)},
+		{0, nullptr}
+	};
+
+	PyType_Spec sectionSpec = {
+		"iv.Section", sizeof(SectionObject), 0, Py_TPFLAGS_DEFAULT, sectionSlots
+	};
+}
+
+// iv.ini的各项操作都直接查询Target
+bool IniView::checkTarget() {
+	if (!Target)
+		PyErr_SetString(PyExc_RuntimeError, "当前没有正在检查的ini");
+	return Target != nullptr;
+}
+
+PyObject* IniView::iniIter(PyObject*) {
+	if (!checkTarget())
+		return nullptr;
+	PyObject* names = PyList_New(0);
+	for (const auto& [name, _] : Target->sections) {
+		PyObject* pyName = PyUnicode_FromStringAndSize(name.data(), name.size());
+		PyList_Append(names, pyName);
+		Py_XDECREF(pyName);
+	}
+	PyObject* iter = PyObject_GetIter(names);
+	Py_DECREF(names);
+	return iter;
+}
+
+Py_ssize_t IniView::iniLength(PyObject*) {
+	return checkTarget() ? static_cast<Py_ssize_t>(Target->sections.size()) : -1;
+}
+
+PyObject* IniView::iniSubscript(PyObject*, PyObject* key) {
+	if (!checkTarget())
+		return nullptr;
+	const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+	PyObject* section = name ? getSection(std::string(name)) : nullptr;
+	if (!section && !PyErr_Occurred())
+		PyErr_SetObject(PyExc_KeyError, key);
+	return Py_XNewRef(section);
+}
+
+int IniView::iniContains(PyObject*, PyObject* key) {
+	if (!checkTarget())
+		return -1;
+	const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+	return name ? Target->sections.contains(name) : 0;
+}
+
+int IniView::init(PyObject* module) {
+	auto state = new State{};
+	*static_cast<State**>(PyModule_GetState(module)) = state;
+	state->sectionType = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&sectionSpec));
+	if (!state->sectionType)
+		return -1;
+
+	static PyType_Slot iniSlots[] = {
+		{Py_tp_iter,		reinterpret_cast<void*>(iniIter)},
+		{Py_mp_length,		reinterpret_cast<void*>(iniLength)},
+		{Py_mp_subscript,	reinterpret_cast<void*>(iniSubscript)},
+		{Py_sq_contains,	reinterpret_cast<void*>(iniContains)},
+		{0, nullptr}
+	};
+	static PyType_Spec iniSpec = {
+		"iv.Ini", sizeof(PyObject), 0, Py_TPFLAGS_DEFAULT, iniSlots
+	};
+	state->iniType = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&iniSpec));
+	if (!state->iniType)
+		return -1;
+
+	PyObject* ini = PyType_GenericAlloc(state->iniType, 0);
+	if (!ini || PyModule_AddObject(module, "ini", ini) < 0) {
+		Py_XDECREF(ini);
+		return -1;
+	}
+	Current = state;
+	return 0;
+}
+
+void IniView::release(void* module) {
+	auto state = *static_cast<State**>(PyModule_GetState(static_cast<PyObject*>(module)));
+	if (!state)
+		return;
+	clear(*state);
+	Py_XDECREF(state->iniType);
+	Py_XDECREF(state->sectionType);
+	if (Current == state)
+		Current = nullptr;
+	delete state;
+}
+
+void IniView::attach(const IniFile& ini) {
+	clear();
+	Target = &ini;
+}
+
+void IniView::detach() {
+	clear();
+	Target = nullptr;
+}
+
+void IniView::clear() {
+	if (Current)
+		clear(*Current);
+}
+
+void IniView::clear(State& state) {
+	for (auto& [_, section] : state.sections) {
+		reinterpret_cast<SectionObject*>(section)->section = nullptr;
+		Py_DECREF(section);
+	}
+	state.sections.clear();
+}
+
+PyObject* IniView::getSection(const Section& section) {
+	if (!Current) {
+		PyErr_SetString(PyExc_RuntimeError, "当前解释器尚未导入iv模块");
+		return nullptr;
+	}
+	auto it = Current->sections.find(&section);
+	if (it != Current->sections.end())
+		return it->second;
+
+	auto object = PyObject_New(SectionObject, Current->sectionType);
+	if (!object)
+		return nullptr;
+	object->section = &section;
+	object->values = PyDict_New();
+	object->complete = false;
+	return Current->sections[&section] = reinterpret_cast<PyObject*>(object);
+}
+
+PyObject* IniView::getSection(const std::string& name) {
+	if (!Target)
+		return nullptr;
+	auto it = Target->sections.find(name);
+	return it != Target->sections.end() ? getSection(it->second) : nullptr;
+}
+
+PyObject* IniView::getValue(PyObject* section, PyObject* key) {
+	auto object = checkSection(section);
+	return object ? sectionValue(object, key) : nullptr;
+}
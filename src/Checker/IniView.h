@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "IniFile.h"
+#include <Python.h>
+#include <unordered_map>
+
+// 供Python脚本使用的只读映射类型, 直接引用C++中的IniFile和Section, 不复制数据
+// iv.ini:         节名 -> 节, 可用iv.ini["Animations"]访问任意节
+// Section:        键 -> 值字符串, 值在第一次被访问时才转为Python字符串并缓存
+// 节对象按地址缓存, 同一节在所有脚本调用中是同一个对象; clear之后旧对象失效, 再访问会抛出RuntimeError
+// 类型和节对象属于各个解释器, 每个子解释器导入iv时各自创建一份, Target在所有解释器间共享
+class IniView {
+public:
+	static constexpr Py_ssize_t StateSize = sizeof(void*);	// iv模块的模块状态大小
+
+	static int init(PyObject* module);						// iv模块的执行函数, 在当前解释器中注册类型和iv.ini
+	static void release(void* module);						// iv模块释放时销毁所属解释器的状态
+	static void attach(const IniFile& ini);					// 开始检查ini
+	static void detach();									// 结束检查, ini被修改或释放前调用
+	static void clear();									// 释放当前解释器中的所有节对象
+
+	static PyObject* getSection(const Section& section);	// 获取节对象, 借用引用
+	static PyObject* getSection(const std::string& name);	// 按节名获取节对象, 不存在时返回nullptr, 借用引用
+	static PyObject* getValue(PyObject* section, PyObject* key);	// 获取缓存的值字符串, 不存在时返回nullptr, 借用引用
+
+private:
+	// 每个解释器各自的类型和节对象
+	struct State {
+		PyTypeObject* sectionType;
+		PyTypeObject* iniType;
+		std::unordered_map<const Section*, PyObject*> sections;
+	};
+
+	static void clear(State& state);
+	static bool checkTarget();
+	static PyObject* iniIter(PyObject* self);
+	static Py_ssize_t iniLength(PyObject* self);
+	static PyObject* iniSubscript(PyObject* self, PyObject* key);
+	static int iniContains(PyObject* self, PyObject* key);
+
+	static const IniFile* Target;
+	static thread_local State* Current;	// 当前线程所用解释器的状态, 每个线程只在一个解释器中调用脚本
+};
@@ -1,6 +1,7 @@
 ﻿#include "Helper.h"
 #include "LimitChecker.h"
 #include "Log.h"
+#include "Profiler.h"
 #include <sstream>
 
 LimitChecker::LimitChecker(const Section& config) {
@@ -16,9 +17,23 @@ LimitChecker::LimitChecker(const Section& config) {
 
 	if (config.contains("MaxLength"))
 		maxLength = std::stoi(config.at("MaxLength"));
-	if (config.contains("CaseSenstive")) {
-		char res = config.at("CaseSenstive")().front();
-		caseSensitive = res == '1' || res == 'y' || res == 't';
+	// CaseSenstive是旧版本的拼写, 仍然兼容
+	for (const char* name : { "CaseSensitive", "CaseSenstive" }) {
+		if (config.contains(name)) {
+			const auto& value = config.at(name).value;
+			caseSensitive = !value.empty() && string::isBool(value);
+			break;
+		}
+	}
+
+	// 编译 Pattern, 需在读取大小写设置之后
+	if (config.contains("Pattern")) {
+		try {
+			pattern = Pattern(config.at("Pattern").value, caseSensitive);
+		}
+		catch (const std::invalid_argument& e) {
+			Log::error<_LimitCheckerPatternInvalid>({ config, "Pattern" }, config.at("Pattern").value, e.what());
+		}
 	}
 }
 
@@ -29,10 +44,12 @@ std::vector<std::string> LimitChecker::getToken(const Section& config, const std
 }
 
 void LimitChecker::validate(const Section& section, const std::string& key, const std::string& value) const {
+	Profiler::Scope profile(Profiler::Category::Checker, "LimitChecker");
 	if (matchesStart(section, key, value))
 		if (matchesEnd(section, key, value))
 			if (matchesList(section, key, value))
-				matchesLength(section, key, value);
+				if (matchesPattern(section, key, value))
+					matchesLength(section, key, value);
 }
 
 bool LimitChecker::matchesStart(const Section& section, const std::string& key, const std::string& value) const {
@@ -76,6 +93,14 @@ bool LimitChecker::matchesList(const Section& section, const std::string& key, c
 	return false;
 }
 
+bool LimitChecker::matchesPattern(const Section& section, const std::string& key, const std::string& value) const {
+	if (pattern.empty() || pattern.match(value))
+		return true;
+
+	Log::error<_LimitCheckerPatternIllegal>({ section,key }, value, pattern.source());
+	return false;
+}
+
 void LimitChecker::matchesLength(const Section& section, const std::string& key, const std::string& value) const {
 	if (value.length() > maxLength)
 		Log::error<_LimitCheckerOverRange>({ section,key }, value.length(), maxLength);
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "IniFile.h"
+#include "Pattern.h"
 #include <algorithm>
 #include <string>
 #include <unordered_map>
@@ -10,8 +11,9 @@
 // StartWith = 前缀的限定内容, 不填则不检查
 // EndWith = 后缀的限定内容, 不填则不检查
 // LimitIn = 整体的限定内容, 不填则不检查
+// Pattern = 整体需要匹配的正则表达式, 加载时编译, 语法见Pattern.h
 // MaxLength = 字符串的长度限制
-// IgnoreCase = 是否忽略大小写检查, 作用于前面三条
+// CaseSensitive = 是否区分大小写, 作用于前面四条, 默认不区分
 class LimitChecker {
 public:
 	explicit LimitChecker(){};
@@ -23,6 +25,8 @@ public:
 		startWith = other.startWith;
 		endWith = other.endWith;
 		limitIn = other.limitIn;
+		pattern = other.pattern;
+		maxLength = other.maxLength;
 		caseSensitive = other.caseSensitive;
 		return *this;
 	}
@@ -30,12 +34,14 @@ private:
 	bool matchesStart(const Section& section, const std::string& key, const std::string& value) const;
 	bool matchesEnd(const Section& section, const std::string& key, const std::string& value) const;
 	bool matchesList(const Section& section, const std::string& key, const std::string& value) const;
+	bool matchesPattern(const Section& section, const std::string& key, const std::string& value) const;
 	void matchesLength(const Section& section, const std::string& key, const std::string& value) const;
     std::string checkLower(const std::string& str) const;
 
 	std::vector<std::string> startWith;
 	std::vector<std::string> endWith;
 	std::vector<std::string> limitIn;
+	Pattern pattern;
 	int maxLength{ INT_MAX };
 	bool caseSensitive{ false };
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Helper.h"
 #include "ListChecker.h"
 #include "Log.h"
+#include "Profiler.h"
 #include <sstream>
 
 ListChecker::ListChecker(Checker* checker, const Section& config) :checker(checker) {
@@ -27,6 +28,7 @@ ListChecker::ListChecker(Checker* checker, const Section& config) :checker(check
 }
 
 void ListChecker::validate(const Section& section, const std::string& key, const Value& value) const {
+	Profiler::Scope profile(Profiler::Category::Checker, "ListChecker");
 	int line = value.line;
 	std::vector<Value> values;
 	std::istringstream stream(value);
@@ -1,5 +1,6 @@
 ﻿#include "NumberChecker.h"
 #include "Log.h"
+#include "Profiler.h"
 
 NumberChecker::NumberChecker(const Section& config) {
 	if (config.contains("Range")) {
@@ -17,6 +18,7 @@ NumberChecker::NumberChecker(const Section& config) {
 }
 
 void NumberChecker::validate(const Section& section, const std::string& key, const std::string& value) const {
+	Profiler::Scope profile(Profiler::Category::Checker, "NumberChecker");
 	float intValue = std::stof(value);
 	if (!checkRange(intValue))
 		Log::error<_NumberCheckerOverRange>({ section,key }, value, minRange, maxRange);
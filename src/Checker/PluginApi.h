@@ -0,0 +1,68 @@
+﻿#pragma once
+// 原生检查器插件的C接口, 插件作者只需包含此文件
+// 插件编译为动态库(Windows为.dll, 其他平台为.so)放在Scripts文件夹中, 与Python脚本一样按类型名调用
+// 所有字符串都以(data, size)传递, 不保证以'\0'结尾, 在一次调用期间有效
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IV_PLUGIN_ABI_VERSION 1
+#define IV_PLUGIN_ENTRY "iv_plugin_entry"
+
+#if defined(_WIN32)
+#define IV_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define IV_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+// 状态码, 与Python脚本的返回值相同
+enum {
+	IV_OK = -1,			// 没有错误, 不会报错
+	IV_DEFAULT = 0,		// 程序自身导致的错误
+	IV_INFO = 1,		// 不影响游戏运行
+	IV_WARNING = 2,		// 可能产生非预期结果
+	IV_ERROR = 3,		// 会导致游戏崩溃
+};
+
+typedef struct iv_string {
+	const char* data;
+	size_t size;
+} iv_string;
+
+// 一个待检查的键值, 列表检查器传入的value是列表中的单个元素
+typedef struct iv_item {
+	const void* section;	// 节句柄, 可传给iv_host::get_value
+	iv_string section_name;
+	iv_string key;
+	iv_string value;
+} iv_item;
+
+// 检查结果, message由插件持有, 只需在下一次调用前有效; 批量检查时所有结果的message都要保持到下一次调用
+typedef struct iv_result {
+	int code;
+	iv_string message;
+} iv_result;
+
+// 程序提供给插件的函数, 用于读取正在检查的ini中的其他节
+typedef struct iv_host {
+	uint32_t abi_version;
+	const void* (*find_section)(iv_string name);								// 按节名查找节句柄, 不存在时返回NULL
+	int (*get_value)(const void* section, iv_string key, iv_string* value);	// 读取节中的值, 键不存在时返回0
+} iv_host;
+
+typedef struct iv_plugin {
+	uint32_t abi_version;	// 必须为IV_PLUGIN_ABI_VERSION
+	const char* type;		// 注册的类型名, 为NULL时使用文件名
+	iv_result (*validate)(const iv_host* host, const iv_item* item);	// 检查单个键值, 必须提供
+	void (*validate_batch)(const iv_host* host, const iv_item* items, size_t count, iv_result* results);	// 批量检查, 可以为NULL, results与items一一对应
+} iv_plugin;
+
+// 插件导出的入口函数, 名为IV_PLUGIN_ENTRY, 加载时调用一次, 返回的结构体需在插件卸载前保持有效
+typedef const iv_plugin* (*iv_plugin_entry_fn)(const iv_host* host);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+﻿#include "PluginChecker.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef _WIN32
+#include <windows.h>
+#define PLUGIN_EXTENSION ".dll"
+#else
+#include <dlfcn.h>
+#define PLUGIN_EXTENSION ".so"
+#endif
+
+const IniFile* PluginChecker::Target = nullptr;
+const iv_host PluginChecker::Host = { IV_PLUGIN_ABI_VERSION, PluginChecker::findSection, PluginChecker::getValue };
+
+PluginChecker::PluginChecker(const std::string& pluginDir) {
+	if (!std::filesystem::exists(pluginDir) || !std::filesystem::is_directory(pluginDir))
+		return;
+
+	for (const auto& entry : std::filesystem::directory_iterator(pluginDir))
+		if (entry.is_regular_file() && entry.path().extension() == PLUGIN_EXTENSION)
+			load(entry.path());
+}
+
+PluginChecker::~PluginChecker() {
+	for (auto& [_, plugin] : plugins) {
+#ifdef _WIN32
+		FreeLibrary(static_cast<HMODULE>(plugin.library));
+#else
+		dlclose(plugin.library);
+#endif
+	}
+	Target = nullptr;
+}
+
+// 加载插件并检查接口版本, 同名类型只保留第一个
+void PluginChecker::load(const std::filesystem::path& path) {
+#ifdef _WIN32
+	void* library = LoadLibraryW(path.c_str());
+	auto entry = library ? reinterpret_cast<iv_plugin_entry_fn>(GetProcAddress(static_cast<HMODULE>(library), IV_PLUGIN_ENTRY)) : nullptr;
+#else
+	void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	auto entry = library ? reinterpret_cast<iv_plugin_entry_fn>(dlsym(library, IV_PLUGIN_ENTRY)) : nullptr;
+#endif
+	auto unload = [library] {
+		if (!library)
+			return;
+#ifdef _WIN32
+		FreeLibrary(static_cast<HMODULE>(library));
+#else
+		dlclose(library);
+#endif
+	};
+
+	if (!entry) {
+		unload();
+		return Log::out("加载插件失败, 找不到入口函数{}: {}", IV_PLUGIN_ENTRY, path.string());
+	}
+
+	const iv_plugin* api = entry(&Host);
+	if (!api || api->abi_version != IV_PLUGIN_ABI_VERSION || !api->validate) {
+		unload();
+		return Log::out("插件接口版本不匹配或缺少validate函数: {}", path.string());
+	}
+
+	std::string type = api->type ? api->type : path.stem().string();
+	if (!plugins.try_emplace(type, Plugin{ library, api, {} }).second) {
+		unload();
+		Log::out("插件类型{}重复注册, 已忽略: {}", type, path.string());
+	}
+}
+
+void PluginChecker::attach(const IniFile& targetIni) {
+	Target = &targetIni;
+}
+
+const void* PluginChecker::findSection(iv_string name) {
+	if (!Target)
+		return nullptr;
+	auto it = Target->sections.find(std::string(name.data, name.size));
+	return it != Target->sections.end() ? &it->second : nullptr;
+}
+
+int PluginChecker::getValue(const void* section, iv_string key, iv_string* value) {
+	if (!section)
+		return 0;
+	const auto& values = static_cast<const Section*>(section)->section;
+	auto it = values.find(std::string(key.data, key.size));
+	if (it == values.end())
+		return 0;
+	if (value)
+		*value = toString(it->second.value);
+	return 1;
+}
+
+// 与Python脚本的状态码含义相同
+void PluginChecker::report(const iv_result& result, const Section& section, const std::string& key, const std::string& type) {
+	if (result.code == IV_OK)
+		return;
+	std::string message(result.message.data ? result.message.data : "", result.message.data ? result.message.size : 0);
+	switch (result.code) {
+	case IV_DEFAULT:
+		Log::print<0>({ section, key }, message);
+		break;
+	case IV_INFO:
+		Log::info<0>({ section, key }, message);
+		break;
+	case IV_WARNING:
+		Log::warning<0>({ section, key }, message);
+		break;
+	case IV_ERROR:
+		Log::error<0>({ section, key }, message);
+		break;
+	default:
+		Log::out("插件{}返回了非预期的状态码:{}", type, result.code);
+		Log::out(message);
+		break;
+	}
+}
+
+// 提供了validate_batch的插件只记录待检查的键值, 攒满一批或遍历结束时再统一调用
+void PluginChecker::validate(const Section& section, const std::string& key, const Value& value, const std::string& type) {
+	Profiler::Scope profile(Profiler::Category::Checker, "PluginChecker");
+	auto& plugin = plugins.at(type);
+	if (plugin.api->validate_batch) {
+		plugin.pending.push_back({ &section, key, value.value });
+		if (plugin.pending.size() >= BatchSize)
+			flush(plugin, type);
+		return;
+	}
+
+	Profiler::Scope profileScript(Profiler::Category::Script, type);
+	iv_item item{ &section, toString(section.name), toString(key), toString(value.value) };
+	report(plugin.api->validate(&Host, &item), section, key, type);
+}
+
+void PluginChecker::flush() {
+	for (auto& [type, plugin] : plugins)
+		if (!plugin.pending.empty())
+			flush(plugin, type);
+}
+
+void PluginChecker::flush(Plugin& plugin, const std::string& type) {
+	Profiler::Scope profileScript(Profiler::Category::Script, type);
+	auto pending = std::move(plugin.pending);
+	plugin.pending.clear();
+
+	std::vector<iv_item> items;
+	items.reserve(pending.size());
+	for (const auto& item : pending)
+		items.push_back({ item.section, toString(item.section->name), toString(item.key), toString(item.value) });
+
+	std::vector<iv_result> results(items.size(), { IV_OK, { nullptr, 0 } });
+	plugin.api->validate_batch(&Host, items.data(), items.size(), results.data());
+	for (size_t i = 0; i < pending.size(); ++i)
+		report(results[i], *pending[i].section, pending[i].key, type);
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "IniFile.h"
+#include "PluginApi.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 原生检查器插件, 从Scripts文件夹加载动态库, 按插件注册的类型名调用
+// 插件在构造时加载, 直到析构才卸载, 反复检查时不会重新加载
+class PluginChecker {
+public:
+	explicit PluginChecker(const std::string& pluginDir);
+	~PluginChecker();
+	PluginChecker(const PluginChecker&) = delete;
+	PluginChecker& operator=(const PluginChecker&) = delete;
+
+	void attach(const IniFile& targetIni); // 开始检查targetIni, 每次检查前调用
+	void validate(const Section& section, const std::string& key, const Value& value, const std::string& type);
+	void flush(); // 执行所有尚未提交的批量检查
+	bool contains(const std::string& type) const {
+		return plugins.contains(type);
+	}
+
+private:
+	// 等待批量检查的键值, 值可能是列表中的单个元素, 因此单独保存
+	struct Item {
+		const Section* section;
+		std::string key;
+		std::string value;
+	};
+
+	struct Plugin {
+		void* library;
+		const iv_plugin* api;
+		std::vector<Item> pending;
+	};
+
+	static constexpr size_t BatchSize = 4096; // 每批最多的键值数量
+
+	static const iv_host Host;
+	static const IniFile* Target;
+	static const void* findSection(iv_string name);
+	static int getValue(const void* section, iv_string key, iv_string* value);
+	static iv_string toString(std::string_view str) { return { str.data(), str.size() }; }
+
+	void load(const std::filesystem::path& path);
+	void flush(Plugin& plugin, const std::string& type);
+	void report(const iv_result& result, const Section& section, const std::string& key, const std::string& type);
+
+	std::unordered_map<std::string, Plugin> plugins; // 类型名 <-> 插件
+};
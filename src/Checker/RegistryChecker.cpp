@@ -1,6 +1,7 @@
 ﻿#include "Checker.h"
 #include "Helper.h"
 #include "Log.h"
+#include "Profiler.h"
 #include "RegistryChecker.h"
 #include "Settings.h"
 
@@ -41,6 +42,7 @@ void RegistryChecker::validatePreserItem(const Section::Key& registryName, const
 }
 
 void RegistryChecker::validateSection(const Section::Key& registryName, const Value& name) const {
+	Profiler::Scope profile(Profiler::Category::Checker, "RegistryChecker");
 	if (!checker->targetIni->sections.contains(name)) {
 		if (checkExist)
 			Log::warning<_SectionExist>({ registryName, name.fileIndex, name.line }, name.value);
@@ -7,7 +7,7 @@
 class Checker;
 class RegistryChecker {
 public:
-	using Sections = std::unordered_map<std::string, Section>;
+	using Sections = IniFile::Sections;
 	operator std::string() const { return type; }
 
 	RegistryChecker() = default;
@@ -0,0 +1,188 @@
+﻿#include "Checker.h"
+#include "Helper.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "ResultCache.h"
+#include "TupleChecker.h"
+#include <charconv>
+#include <sstream>
+
+namespace {
+	std::string_view trim(std::string_view str) {
+		auto begin = str.find_first_not_of(" \t");
+		if (begin == std::string_view::npos)
+			return {};
+		auto end = str.find_last_not_of(" \t");
+		return str.substr(begin, end - begin + 1);
+	}
+
+	std::vector<std::string_view> splitFields(std::string_view str, char separator) {
+		std::vector<std::string_view> parts;
+		size_t start = 0;
+		while (true) {
+			auto end = str.find(separator, start);
+			parts.push_back(trim(str.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start)));
+			if (end == std::string_view::npos)
+				return parts;
+			start = end + 1;
+		}
+	}
+}
+
+TupleChecker::TupleChecker(Checker* checker, const Section& config) :checker(checker) {
+	// 加载 Type
+	if (!config.contains("Type")) {
+		Log::error<_TupleCheckerUnknownType>(config.line);
+		return;
+	}
+	for (const auto& type : string::split(config.at("Type").value)) {
+		Field field;
+		field.type = std::string(trim(type));
+		if (field.type == "int") field.kind = Field::Kind::Int;
+		else if (field.type == "float") field.kind = Field::Kind::Float;
+		else if (field.type == "double") field.kind = Field::Kind::Double;
+		else if (field.type == "string") field.kind = Field::Kind::String;
+		else if (checker->numberLimits.contains(field.type)) {
+			field.kind = Field::Kind::Number;
+			field.number = &checker->numberLimits.at(field.type);
+		}
+		else if (checker->limits.contains(field.type)) {
+			field.kind = Field::Kind::Limit;
+			field.limit = &checker->limits.at(field.type);
+		}
+		else if (checker->registries.contains(field.type))
+			field.kind = Field::Kind::Registry;
+		fields.push_back(std::move(field));
+	}
+
+	// 加载 Optional, 不是非负整数时报告并按0处理
+	if (config.contains("Optional")) {
+		const auto& value = config.at("Optional");
+		std::istringstream optionalStream(value);
+		int count;
+		if (optionalStream >> count && count >= 0 && (optionalStream >> std::ws).eof())
+			optional = (std::min)(static_cast<size_t>(count), fields.size());
+		else
+			Log::error<_TupleCheckerOptionalIllegal>(value.line, value.value);
+	}
+	if (config.contains("Separator") && !config.at("Separator").value.empty())
+		separator = config.at("Separator").value.front();
+	if (config.contains("Group") && config.at("Group").value.size() == 2) {
+		open = config.at("Group").value[0];
+		close = config.at("Group").value[1];
+	}
+
+	// 加载 Repeat, 不填最大值时不限制; 格式错误时报告并按默认的1,1处理
+	if (config.contains("Repeat")) {
+		const auto& value = config.at("Repeat");
+		auto parts = splitFields(value.value, ',');
+		int range[2] = { 0, INT_MAX };
+		bool valid = parts.size() <= 2;
+		for (size_t i = 0; valid && i < parts.size(); ++i) {
+			auto [ptr, ec] = std::from_chars(parts[i].data(), parts[i].data() + parts[i].size(), range[i]);
+			valid = ec == std::errc() && ptr == parts[i].data() + parts[i].size() && range[i] >= 0;
+		}
+		if (valid && range[0] <= range[1]) {
+			minRepeat = range[0];
+			maxRepeat = range[1];
+		}
+		else
+			Log::error<_TupleCheckerRepeatIllegal>(value.line, value.value);
+	}
+}
+
+void TupleChecker::validate(const Section& section, const std::string& key, const Value& value) const {
+	Profiler::Scope profile(Profiler::Category::Checker, "TupleChecker");
+	if (fields.empty())
+		return;
+	std::string_view text = value.value;
+	int line = value.line;
+
+	// 没有括号时整个值就是一个元组
+	if (!open)
+		return validateGroup(section, key, text, line);
+
+	// 逐个取出括号中的内容, 括号之间以分隔符相连
+	std::vector<std::string_view> groups;
+	size_t pos = 0;
+	while (true) {
+		pos = text.find_first_not_of(" \t", pos);
+		if (pos == std::string_view::npos || text[pos] != open)
+			return Log::error<_TupleCheckerGroupIllegal>({ section, key }, value, open, close);
+		auto end = text.find(close, pos + 1);
+		if (end == std::string_view::npos)
+			return Log::error<_TupleCheckerGroupIllegal>({ section, key }, value, open, close);
+		groups.push_back(text.substr(pos + 1, end - pos - 1));
+
+		pos = text.find_first_not_of(" \t", end + 1);
+		if (pos == std::string_view::npos)
+			break;
+		if (text[pos] != separator)
+			return Log::error<_TupleCheckerGroupIllegal>({ section, key }, value, open, close);
+		++pos;
+	}
+
+	auto count = static_cast<int>(groups.size());
+	if (count < minRepeat || count > maxRepeat)
+		return Log::error<_TupleCheckerRepeatOverRange>({ section, key }, minRepeat, maxRepeat);
+	for (auto group : groups)
+		validateGroup(section, key, group, line);
+}
+
+void TupleChecker::validateGroup(const Section& section, const std::string& key, std::string_view group, int line) const {
+	auto parts = splitFields(group, separator);
+	if (parts.size() < fields.size() - optional || parts.size() > fields.size())
+		return Log::error<_TupleCheckerCountIllegal>({ section, key }, group, fields.size() - optional, fields.size(), parts.size());
+
+	for (size_t i = 0; i < parts.size(); ++i)
+		validateField(section, key, fields[i], Value(std::string(parts[i]), line));
+}
+
+void TupleChecker::validateField(const Section& section, const std::string& key, const Field& field, const Value& value) const {
+	if (value.value.empty())
+		return Log::error<_EmptyValue>({ section, key }, key);
+
+	switch (field.kind) {
+	case Field::Kind::Int:
+		checker->validateInteger(section, key, value);
+		break;
+	case Field::Kind::Float:
+		checker->validateFloat(section, key, value);
+		break;
+	case Field::Kind::Double:
+		checker->validateDouble(section, key, value);
+		break;
+	case Field::Kind::String:
+		checker->validateString(section, key, value);
+		break;
+	case Field::Kind::Number:
+		try {
+			field.number->validate(section, key, value);
+		}
+		catch (const std::exception&) {
+			Log::error<_IllegalValue>({ section, key }, value);
+		}
+		break;
+	case Field::Kind::Limit:
+		field.limit->validate(section, key, value);
+		break;
+	case Field::Kind::Registry:
+		validateRegistered(section, key, field.type, value);
+		break;
+	default:
+		checker->validate(section, key, value, field.type);
+		break;
+	}
+}
+
+// 只检查名字是否登记在注册表中, 不检查对应的节; 注册表改变时引用它的节需要重新检查
+void TupleChecker::validateRegistered(const Section& section, const std::string& key, const std::string& registry, const Value& value) const {
+	if (value.value == "none" || value.value == "<none>")
+		return;
+
+	ResultCache::lookup(registry);
+	auto it = checker->registeredNames.find(registry);
+	if (it != checker->registeredNames.end() && it->second.contains(value.value))
+		return;
+	Log::error<_TupleCheckerNotRegistered>({ section, key }, value, registry);
+}
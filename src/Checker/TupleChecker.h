@@ -0,0 +1,47 @@
+﻿#pragma once
+#include "IniFile.h"
+#include <climits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 按位置声明类型的元组, 例如"5,ARMOR,yes"或"(255,0,0),(0,255,0)"
+// [Tuples]
+// Type = 各位置的类型, 可填int、float、double、string以及Sections、NumberLimits、Limits等中的值
+//        填Registries中的注册表名时, 该位置必须是目标ini中这个注册表登记过的名字, 例如Animations
+// Optional = 末尾可以省略的位置数, 默认0
+// Separator = 位置之间的分隔符, 默认逗号
+// Group = 每个元组两侧的括号, 例如(), 默认没有
+// Repeat = 元组个数最小值, 元组个数最大值, 默认1,1; 不填最大值时不限制, 需配合Group使用
+class Checker;
+class NumberChecker;
+class LimitChecker;
+class TupleChecker {
+public:
+	TupleChecker() = default;
+	TupleChecker(Checker* checker, const Section& config);
+	void validate(const Section& section, const std::string& key, const Value& value) const;
+
+private:
+	// 加载时把类型名解析为具体的检查器, 检查时不再按名字查找
+	struct Field {
+		enum class Kind { Int, Float, Double, String, Number, Limit, Registry, Other };
+		Kind kind{ Kind::Other };
+		std::string type;
+		const NumberChecker* number{ nullptr };
+		const LimitChecker* limit{ nullptr };
+	};
+
+	void validateGroup(const Section& section, const std::string& key, std::string_view group, int line) const;
+	void validateField(const Section& section, const std::string& key, const Field& field, const Value& value) const;
+	void validateRegistered(const Section& section, const std::string& key, const std::string& registry, const Value& value) const;
+
+	Checker* checker{ nullptr };
+	std::vector<Field> fields;
+	size_t optional{ 0 };
+	char separator{ ',' };
+	char open{ 0 };			// 为0时没有括号
+	char close{ 0 };
+	int minRepeat{ 1 };
+	int maxRepeat{ 1 };
+};
@@ -1,13 +1,18 @@
 ﻿#include "Checker.h"
 #include "Helper.h"
 #include "Log.h"
+#include "Profiler.h"
+#include "ResultCache.h"
 #include "TypeChecker.h"
 
 void TypeChecker::validate(const Section& section, const std::string& key, const Value& value, const std::string& type) {
+	Profiler::Scope profile(Profiler::Category::Checker, "TypeChecker");
 	auto checker = Checker::Instance;
 	if (value.value == "none" || value.value == "<none>")
 		return;
 
+	// 无论该节是否存在都要记录, 之后新增这个节时引用它的节需要重新检查
+	ResultCache::lookup(value);
 	if (!checker->targetIni->sections.contains(value)) {
 		if (type != "AnimType")
 			Log::error< _TypeCheckerTypeNotExist>({ section,key }, type, value);
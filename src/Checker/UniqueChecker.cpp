@@ -0,0 +1,51 @@
+﻿#include "Helper.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "UniqueChecker.h"
+#include <algorithm>
+
+UniqueChecker::Scope UniqueChecker::parseScope(const std::string& str) {
+	if (str == "registry") return Scope::Registry;
+	if (str == "file") return Scope::File;
+	if (str == "global") return Scope::Global;
+	return Scope::None;
+}
+
+void UniqueChecker::insert(const std::string& group, const Section& section, const std::string& key, const std::string& value) {
+	auto full = group;
+	full += '\0';
+	full += value;
+	auto& shard = shards[fold::hashName(full) % ShardCount];
+	std::lock_guard lock(shard.mutex);
+	shard.values[std::move(full)].push_back({ &section, key });
+}
+
+void UniqueChecker::report() {
+	Profiler::Scope profile(Profiler::Category::Checker, "UniqueChecker");
+	for (auto& shard : shards) {
+		std::lock_guard lock(shard.mutex);
+		for (auto& [_, occurrences] : shard.values) {
+			if (occurrences.size() < 2)
+				continue;
+
+			// 以文件中最早出现的位置作为首次定义, 与遍历顺序无关
+			auto valueOf = [](const Occurrence& occurrence) -> const Value& {
+				return occurrence.section->section.at(occurrence.key);
+			};
+			std::sort(occurrences.begin(), occurrences.end(), [&](const Occurrence& a, const Occurrence& b) {
+				const auto& l = valueOf(a);
+				const auto& r = valueOf(b);
+				return l.fileIndex == r.fileIndex ? l.line < r.line : l.fileIndex < r.fileIndex;
+			});
+
+			const auto& first = occurrences.front();
+			const auto& firstValue = valueOf(first);
+			for (size_t i = 1; i < occurrences.size(); ++i) {
+				const auto& occurrence = occurrences[i];
+				Log::warning<_UniqueCheckerDuplicate>({ *occurrence.section, occurrence.key }, valueOf(occurrence).value,
+					IniFile::GetFileName(firstValue.fileIndex), firstValue.line, first.section->name, first.key);
+			}
+		}
+		shard.values.clear();
+	}
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+#include "IniFile.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 值在一定范围内不能重复, 例如UIName、Image, 以及注册表中重复的注册项
+// 在类型声明的第四项中指定范围: key = value, default value, from ini file, unique scope
+// registry = 同一类型(即同一注册表)的节之间不能重复
+// file = 同一文件中的节之间不能重复
+// global = 所有节之间不能重复
+// 检查时只记录每个值出现的位置, 全部遍历结束后再统一报告, 重复的值都以最早出现的位置作为首次定义
+class UniqueChecker {
+public:
+	enum class Scope : uint8_t { None, Registry, File, Global };
+	static Scope parseScope(const std::string& str);
+
+	// group区分不同的唯一性范围, 只有同一group中的值才会互相比较; 可以从多个线程同时调用
+	void insert(const std::string& group, const Section& section, const std::string& key, const std::string& value);
+	void report(); // 报告所有重复的值并清空记录, 下一次检查重新记录
+
+private:
+	struct Occurrence {
+		const Section* section;
+		std::string key;
+	};
+
+	// 按哈希分片加锁, 不同分片的插入互不阻塞
+	struct Shard {
+		std::mutex mutex;
+		NameMap<std::vector<Occurrence>> values; // group + 值 <-> 出现位置, 与节名一样不区分大小写
+	};
+
+	static constexpr size_t ShardCount = 16;
+	std::array<Shard, ShardCount> shards;
+};
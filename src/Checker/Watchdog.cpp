@@ -0,0 +1,89 @@
+﻿#include "Watchdog.h"
+
+Watchdog::Guard::Guard(Watchdog& watchdog, std::chrono::milliseconds limit) : watchdog(nullptr) {
+	if (limit.count() <= 0)
+		return;
+	this->watchdog = &watchdog;
+	std::lock_guard<std::mutex> lock(watchdog.mutex);
+	call = watchdog.calls.insert(watchdog.calls.end(), {
+		PyInterpreterState_Get(), PyThread_get_thread_ident(), Clock::now() + limit, false, false
+	});
+	if (!watchdog.thread.joinable())
+		watchdog.thread = std::thread(&Watchdog::run, &watchdog);
+	watchdog.changed.notify_one();
+}
+
+// 监视线程中断时需要该解释器的GIL, 先让出GIL等它完成, 再清除可能还没有生效的异步异常
+// 注销之后解释器才可能被结束, 因此监视线程不会访问已经结束的解释器
+Watchdog::Guard::~Guard() {
+	if (!watchdog)
+		return;
+	std::unique_lock<std::mutex> lock(watchdog->mutex);
+	if (call->interrupting) {
+		lock.unlock();
+		Py_BEGIN_ALLOW_THREADS
+		lock.lock();
+		watchdog->changed.wait(lock, [this] { return !call->interrupting; });
+		lock.unlock();
+		Py_END_ALLOW_THREADS
+		lock.lock();
+	}
+	bool fired = call->fired;
+	watchdog->calls.erase(call);
+	lock.unlock();
+	if (fired)
+		PyThreadState_SetAsyncExc(PyThread_get_thread_ident(), nullptr);
+}
+
+Watchdog::~Watchdog() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	if (thread.joinable())
+		thread.join();
+}
+
+void Watchdog::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping) {
+		auto now = Clock::now();
+		auto next = Clock::time_point::max();
+		Call* expired = nullptr;
+		for (auto& call : calls) {
+			if (call.fired)
+				continue;
+			if (call.deadline <= now) {
+				expired = &call;
+				break;
+			}
+			next = (std::min)(next, call.deadline);
+		}
+
+		if (!expired) {
+			if (next == Clock::time_point::max())
+				changed.wait(lock);
+			else
+				changed.wait_until(lock, next);
+			continue;
+		}
+
+		expired->fired = true;
+		expired->interrupting = true;
+		lock.unlock();
+		interrupt(*expired);
+		lock.lock();
+		expired->interrupting = false;
+		changed.notify_all();
+	}
+}
+
+// 在目标解释器中新建线程状态以获取其GIL, 调用线程此时无法继续执行, 异常会在其下一条字节码处抛出
+void Watchdog::interrupt(Call& call) {
+	PyThreadState* state = PyThreadState_New(call.interp);
+	PyEval_RestoreThread(state);
+	PyThreadState_SetAsyncExc(call.threadId, PyExc_TimeoutError);
+	PyThreadState_Clear(state);
+	PyThreadState_DeleteCurrent();
+}
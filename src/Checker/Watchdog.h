@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <Python.h>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+// 监视Python脚本调用的耗时, 超过期限时通过PyThreadState_SetAsyncExc在脚本所在的线程中抛出TimeoutError
+// 异步异常只在解释器执行字节码时生效, 长时间停留在原生代码中(如正则匹配、sleep)的调用要等返回后才能结束
+// 同一个Watchdog可以同时监视多个线程和子解释器中的调用, 监视线程在第一次需要时启动
+class Watchdog {
+	using Clock = std::chrono::steady_clock;
+
+	struct Call {
+		PyInterpreterState* interp;
+		unsigned long threadId;
+		Clock::time_point deadline;
+		bool fired;			// 已决定中断
+		bool interrupting;	// 监视线程正在等待该解释器的GIL
+	};
+
+public:
+	// 登记当前线程的一次调用, 需在持有GIL时构造和析构, limit为0时不监视
+	class Guard {
+	public:
+		Guard(Watchdog& watchdog, std::chrono::milliseconds limit);
+		~Guard();
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+
+	private:
+		Watchdog* watchdog;
+		std::list<Call>::iterator call;
+	};
+
+	Watchdog() = default;
+	~Watchdog();
+
+private:
+	void run();
+	void interrupt(Call& call);
+
+	std::mutex mutex;					// 不能在持有mutex时获取GIL, 否则会与持有GIL的调用线程死锁
+	std::condition_variable changed;
+	std::list<Call> calls;
+	std::thread thread;
+	bool stopping{ false };
+};
@@ -0,0 +1,286 @@
+﻿#include "WorkerProcess.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+WorkerProcess::WorkerProcess(intptr_t readEnd, intptr_t writeEnd, intptr_t process)
+	:readEnd(readEnd), writeEnd(writeEnd), process(process) {
+}
+
+std::unique_ptr<WorkerProcess> WorkerProcess::connect(int argc, char* argv[]) {
+	if (argc != 4 || argv[1] != Option)
+		return nullptr;
+	intptr_t handles[2];
+	for (int i = 0; i < 2; ++i) {
+		std::string_view arg = argv[i + 2];
+		if (std::from_chars(arg.data(), arg.data() + arg.size(), handles[i]).ec != std::errc())
+			return nullptr;
+	}
+	return std::unique_ptr<WorkerProcess>(new WorkerProcess(handles[0], handles[1]));
+}
+
+bool WorkerProcess::send(std::string_view message) {
+	if (message.size() > MaxMessageSize)
+		return false;
+	auto size = static_cast<uint32_t>(message.size());
+	return writeAll(reinterpret_cast<const char*>(&size), sizeof(size)) && writeAll(message.data(), message.size());
+}
+
+bool WorkerProcess::receive(std::string& message, std::chrono::milliseconds timeout) {
+	using Clock = std::chrono::steady_clock;
+	timedOut = false;
+	deadline = timeout.count() > 0 ? Clock::now() + timeout : Clock::time_point::max();
+	auto read = [&] {
+		uint32_t size = 0;
+		if (!readAll(reinterpret_cast<char*>(&size), sizeof(size)))
+			return false;
+		if (size > MaxMessageSize)
+			return false;
+		// 按块扩大缓冲区, 长度前缀有误时不会在读到数据前就分配整条消息
+		message.clear();
+		while (message.size() < size) {
+			auto offset = message.size();
+			message.resize(offset + (std::min<size_t>)(size - offset, size_t(1) << 20));
+			if (!readAll(message.data() + offset, message.size() - offset))
+				return false;
+		}
+		return true;
+	};
+	bool received = read();
+	deadline = Clock::time_point::max();
+	return received;
+}
+
+#ifdef _WIN32
+std::unique_ptr<WorkerProcess> WorkerProcess::start() {
+	// 子进程一端可继承, 父进程一端不可继承
+	SECURITY_ATTRIBUTES attributes{ sizeof(attributes), nullptr, TRUE };
+	HANDLE toChild[2] = { }, fromChild[2] = { };
+	auto closeAll = [&] {
+		for (auto handle : { toChild[0], toChild[1], fromChild[0], fromChild[1] })
+			if (handle)
+				CloseHandle(handle);
+	};
+	if (!CreatePipe(&toChild[0], &toChild[1], &attributes, 0) || !CreatePipe(&fromChild[0], &fromChild[1], &attributes, 0)
+		|| !SetHandleInformation(toChild[1], HANDLE_FLAG_INHERIT, 0) || !SetHandleInformation(fromChild[0], HANDLE_FLAG_INHERIT, 0)) {
+		closeAll();
+		return nullptr;
+	}
+
+	// 多个线程同时启动工作进程时, 用句柄列表限制每个子进程只继承自己的两个句柄
+	HANDLE inherited[2] = { toChild[0], fromChild[1] };
+	SIZE_T listSize = 0;
+	InitializeProcThreadAttributeList(nullptr, 1, 0, &listSize);
+	std::string list(listSize, '\0');
+	STARTUPINFOEXW startup{ };
+	startup.StartupInfo.cb = sizeof(startup);
+	startup.lpAttributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(list.data());
+	if (!InitializeProcThreadAttributeList(startup.lpAttributeList, 1, 0, &listSize)) {
+		closeAll();
+		return nullptr;
+	}
+	if (!UpdateProcThreadAttribute(startup.lpAttributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited, sizeof(inherited), nullptr, nullptr)) {
+		DeleteProcThreadAttributeList(startup.lpAttributeList);
+		closeAll();
+		return nullptr;
+	}
+
+	std::wstring exe(MAX_PATH, L'\0');
+	exe.resize(GetModuleFileNameW(nullptr, exe.data(), static_cast<DWORD>(exe.size())));
+	auto commandLine = std::format(L"\"{}\" {} {} {}", exe, std::wstring(Option.begin(), Option.end()),
+		reinterpret_cast<intptr_t>(toChild[0]), reinterpret_cast<intptr_t>(fromChild[1]));
+
+	PROCESS_INFORMATION info{ };
+	BOOL created = CreateProcessW(exe.c_str(), commandLine.data(), nullptr, nullptr, TRUE,
+		EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startup.StartupInfo, &info);
+	DeleteProcThreadAttributeList(startup.lpAttributeList);
+	CloseHandle(toChild[0]);
+	CloseHandle(fromChild[1]);
+	if (!created) {
+		CloseHandle(toChild[1]);
+		CloseHandle(fromChild[0]);
+		return nullptr;
+	}
+	CloseHandle(info.hThread);
+	return std::unique_ptr<WorkerProcess>(new WorkerProcess(reinterpret_cast<intptr_t>(fromChild[0]),
+		reinterpret_cast<intptr_t>(toChild[1]), reinterpret_cast<intptr_t>(info.hProcess)));
+}
+
+void WorkerProcess::terminate() {
+	if (process != -1)
+		TerminateProcess(reinterpret_cast<HANDLE>(process), 1);
+}
+
+WorkerProcess::~WorkerProcess() {
+	CloseHandle(reinterpret_cast<HANDLE>(writeEnd));
+	CloseHandle(reinterpret_cast<HANDLE>(readEnd));
+	if (process != -1) {
+		auto handle = reinterpret_cast<HANDLE>(process);
+		if (WaitForSingleObject(handle, 5000) != WAIT_OBJECT_0)
+			TerminateProcess(handle, 1);
+		CloseHandle(handle);
+	}
+}
+
+// 匿名管道不支持重叠I/O, 有期限时先用PeekNamedPipe轮询, 只读取已到达的部分
+size_t WorkerProcess::readable(size_t size) {
+	if (deadline == std::chrono::steady_clock::time_point::max())
+		return size;
+	for (DWORD wait = 1;; wait = (std::min)(wait * 2, DWORD(10))) {
+		DWORD available = 0;
+		if (!PeekNamedPipe(reinterpret_cast<HANDLE>(readEnd), nullptr, 0, nullptr, &available, nullptr))
+			return 0;
+		if (available)
+			return (std::min)(size, size_t(available));
+		if (std::chrono::steady_clock::now() >= deadline) {
+			timedOut = true;
+			return 0;
+		}
+		Sleep(wait);
+	}
+}
+
+bool WorkerProcess::readAll(char* data, size_t size) {
+	while (size > 0) {
+		DWORD read = 0;
+		auto count = readable((std::min)(size, size_t(1) << 20));
+		if (!count || !ReadFile(reinterpret_cast<HANDLE>(readEnd), data, static_cast<DWORD>(count), &read, nullptr) || read == 0)
+			return false;
+		data += read;
+		size -= read;
+	}
+	return true;
+}
+
+bool WorkerProcess::writeAll(const char* data, size_t size) {
+	while (size > 0) {
+		DWORD written = 0;
+		if (!WriteFile(reinterpret_cast<HANDLE>(writeEnd), data, static_cast<DWORD>((std::min)(size, size_t(1) << 20)), &written, nullptr))
+			return false;
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+#else
+std::unique_ptr<WorkerProcess> WorkerProcess::start() {
+	// 工作进程退出后继续写入时返回错误, 而不是结束整个程序
+	[[maybe_unused]] static const bool ignored = (std::signal(SIGPIPE, SIG_IGN), true);
+
+	int toChild[2], fromChild[2];
+	if (pipe2(toChild, O_CLOEXEC) != 0)
+		return nullptr;
+	if (pipe2(fromChild, O_CLOEXEC) != 0) {
+		close(toChild[0]);
+		close(toChild[1]);
+		return nullptr;
+	}
+	// 子进程一端先移到3和4以外, 映射时才不会互相覆盖
+	int childRead = fcntl(toChild[0], F_DUPFD_CLOEXEC, 5);
+	int childWrite = fcntl(fromChild[1], F_DUPFD_CLOEXEC, 5);
+	close(toChild[0]);
+	close(fromChild[1]);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, childRead, 3);
+	posix_spawn_file_actions_adddup2(&actions, childWrite, 4);
+	std::string option(Option);
+	char exe[] = "/proc/self/exe";
+	char readArg[] = "3", writeArg[] = "4";
+	char* argv[] = { exe, option.data(), readArg, writeArg, nullptr };
+	pid_t pid = -1;
+	bool spawned = childRead >= 0 && childWrite >= 0 && posix_spawn(&pid, exe, &actions, nullptr, argv, environ) == 0;
+	posix_spawn_file_actions_destroy(&actions);
+	close(childRead);
+	close(childWrite);
+	if (!spawned) {
+		close(toChild[1]);
+		close(fromChild[0]);
+		return nullptr;
+	}
+	return std::unique_ptr<WorkerProcess>(new WorkerProcess(fromChild[0], toChild[1], pid));
+}
+
+void WorkerProcess::terminate() {
+	if (process != -1)
+		kill(static_cast<pid_t>(process), SIGKILL);
+}
+
+WorkerProcess::~WorkerProcess() {
+	close(static_cast<int>(writeEnd));
+	close(static_cast<int>(readEnd));
+	if (process != -1) {
+		auto pid = static_cast<pid_t>(process);
+		bool exited = false;
+		for (int i = 0; i < 50 && !(exited = waitpid(pid, nullptr, WNOHANG) != 0); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (!exited) {
+			kill(pid, SIGKILL);
+			waitpid(pid, nullptr, 0);
+		}
+	}
+}
+
+size_t WorkerProcess::readable(size_t size) {
+	using namespace std::chrono;
+	if (deadline == steady_clock::time_point::max())
+		return size;
+	while (true) {
+		auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+		if (remaining <= 0) {
+			timedOut = true;
+			return 0;
+		}
+		pollfd pfd{ static_cast<int>(readEnd), POLLIN, 0 };
+		int ready = poll(&pfd, 1, static_cast<int>((std::min<long long>)(remaining, 1LL << 30)));
+		if (ready > 0)
+			return size;
+		if (ready < 0 && errno != EINTR)
+			return 0;
+	}
+}
+
+bool WorkerProcess::readAll(char* data, size_t size) {
+	while (size > 0) {
+		if (!readable(size))
+			return false;
+		auto count = read(static_cast<int>(readEnd), data, size);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+		data += count;
+		size -= count;
+	}
+	return true;
+}
+
+bool WorkerProcess::writeAll(const char* data, size_t size) {
+	while (size > 0) {
+		auto count = write(static_cast<int>(writeEnd), data, size);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0)
+			return false;
+		data += count;
+		size -= count;
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// 并行执行脚本的工作进程, 与父进程之间通过一对匿名管道交换消息, 每条消息为 长度(4字节) + 字节
+// 工作进程是当前程序的另一个实例, 命令行为 Option 读句柄 写句柄, 启动后由connect取得管道
+// Windows上只把这两个句柄传给子进程, Linux上通过posix_spawn映射到描述符3和4
+class WorkerProcess {
+public:
+	static constexpr std::string_view Option = "--python-worker";
+	static constexpr uint32_t MaxMessageSize = 1u << 30;	// 超过此长度的消息视为损坏
+
+	static std::unique_ptr<WorkerProcess> start();							// 启动工作进程, 失败时返回空指针
+	static std::unique_ptr<WorkerProcess> connect(int argc, char* argv[]);	// 当前进程不是工作进程时返回空指针
+
+	~WorkerProcess();	// 关闭管道, 工作进程读到文件结束后退出; 父进程一侧等待其退出, 超时则强制结束
+	WorkerProcess(const WorkerProcess&) = delete;
+	WorkerProcess& operator=(const WorkerProcess&) = delete;
+
+	bool send(std::string_view message);	// 消息超过MaxMessageSize时返回false
+	// 管道已关闭, 消息不完整或长度超过MaxMessageSize时返回false
+	// timeout不为0时最多等待这么久, 超时也返回false, 之后expired()为true
+	bool receive(std::string& message, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+	bool expired() const { return timedOut; }
+	void terminate();	// 立即结束工作进程, 用于停留在原生代码中无法中断的脚本
+
+private:
+	WorkerProcess(intptr_t readEnd, intptr_t writeEnd, intptr_t process = -1);
+	size_t readable(size_t size);	// 等待到有数据可读, 返回不会阻塞的读取长度, 超过deadline或出错时返回0
+	bool readAll(char* data, size_t size);
+	bool writeAll(const char* data, size_t size);
+
+	intptr_t readEnd;
+	intptr_t writeEnd;
+	intptr_t process;	// 子进程的句柄或pid, 工作进程一侧为-1
+	std::chrono::steady_clock::time_point deadline{ std::chrono::steady_clock::time_point::max() };	// 本次receive的期限
+	bool timedOut{ false };
+};
@@ -1,9 +1,11 @@
 ﻿#include "Dict.h"
+#include "Profiler.h"
 #include "ProgressBar.h"
 #include "Checker.h"
 #include "IniFile.h"
 #include "Log.h"
 #include "Helper.h"
+#include "ResultCache.h"
 
 Dict::Dict(const Section& config) {
 	for (const auto& [key, value] : config) {
@@ -16,18 +18,34 @@ Dict::Dict(const Section& config) {
 }
 
 void Dict::validateSection(const Section& object, const std::string& type) {
+	ResultCache::reference(object.name, type);
 	if (object.isScanned)
 		return;
 
+	Profiler::Scope profile(Profiler::Category::Type, type);
 	Progress::update();
 	const_cast<Section&>(object).isScanned = true;
 
+	// 内容未变的节直接回放上次的日志; 重复值要与其他节比较, 仍需重新登记
+	// 从父节继承的值不是本节写下的, 不参与重复检查, 否则每个子节都会与父节重复
+	// 空值代表清除该键, 同样不参与重复检查
+	ResultCache::Scope cache(object, type);
+	if (cache.replay()) {
+		for (const auto& [key, value] : object)
+			if (!value.isInheritance && !value.value.empty() && this->contains(key))
+				if (auto unique = this->at(key).unique; unique != UniqueChecker::Scope::None)
+					Checker::Instance->validateUnique(unique, type, object, key, value);
+		return;
+	}
+
+	// 动态键生成的名字只对本节有效, 记在局部集合里, 不写回配置的键表
+	Set generated;
 	for (const auto& dynamicKey : this->dynamicKeys) {
 		try {
 			auto keys = generateKey(dynamicKey, object);
 			for (const auto& key : keys) {
 				if (object.contains(key)) {
-					this->keys.insert(key);
+					generated.insert(key);
 					this->validate(dynamicKey, key, object, object.at(key));
 				}
 			}
@@ -42,13 +60,19 @@ void Dict::validateSection(const Section& object, const std::string& type) {
 
 	for (const auto& [key, value] : object) {
 		if (!this->contains(key)) {
-			if (!keys.contains(key))
+			if (!keys.contains(key) && !generated.contains(key))
 				Log::info<_KeyNotExist>({ object, key }, key);
 			continue;
 		}
 
 		this->validate(key, key, object, value);
+		if (value.isInheritance || value.value.empty())
+			continue;
+		if (auto unique = this->at(key).unique; unique != UniqueChecker::Scope::None)
+			Checker::Instance->validateUnique(unique, type, object, key, value);
 	}
+
+	Checker::Instance->validateConstraints(object, type);
 }
 
 void Dict::validate(const Section::Key& key, const Section::Key& vkey, const Section& object, const Value& value) {
@@ -66,6 +90,9 @@ DictData Dict::parseTypeValue(const std::string& str) {
 	std::getline(ss, valueStr, ',');
 	std::getline(ss, retval.defaultValue, ',');
 	std::getline(ss, retval.file, ',');
+	std::string unique;
+	std::getline(ss, unique, ',');
+	retval.unique = UniqueChecker::parseScope(string::trim(unique));
 	retval.types = string::splitAsString(valueStr);
 
 	return retval;
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "Checker/UniqueChecker.h"
 #include "IniFile.h"
 #include <stack>
 #include <string>
@@ -11,12 +12,13 @@ public:
 	std::vector<std::string> types;
 	std::string defaultValue;
 	std::string file;
+	UniqueChecker::Scope unique{ UniqueChecker::Scope::None };
 };
 
 class Dict {
 public:
-	using Map = std::unordered_map<std::string, DictData>;
-	using Set = std::unordered_set<std::string>;
+	using Map = NameMap<DictData>;
+	using Set = NameSet;
 	explicit Dict() = default;
 	Dict(const Section& config);
 	auto begin() { return section.begin(); }
@@ -1,9 +1,20 @@
 ﻿#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <filesystem>
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define IV_SSE2
+#endif
+
 namespace string {
 	static std::vector<std::string> split(const std::string& str, char delimiter = ',') {
 		std::vector<std::string> tokens;
@@ -85,31 +96,72 @@ namespace string {
 		size_t end = str.find_last_not_of(" \t\r\n");
 		return (start == std::string::npos || end == std::string::npos) ? "" : str.substr(start, end - start + 1);
 	}
-	inline std::string escapeJson(const std::string& input) {
-		std::ostringstream oss;
-
-		for (char c : input) {
+	// 将input按JSON字符串转义后追加到out, 不包含两侧引号
+	// 每次检查16字节, 整块无需转义时直接追加, 只有引号、反斜杠和控制字符才逐个处理
+	inline void appendEscapedJson(std::string& out, std::string_view input) {
+		static constexpr char hex[] = "0123456789abcdef";
+		auto escape = [&out](unsigned char c) {
 			switch (c) {
-			case '"': oss << "\\\""; break;
-			case '\\': oss << "\\\\"; break;
-			case '\n': oss << "\\n"; break;
-			case '\r': oss << "\\r"; break;
-			case '\t': oss << "\\t"; break;
-			case '\b': oss << "\\b"; break;
-			case '\f': oss << "\\f"; break;
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			case '\b': out += "\\b"; break;
+			case '\f': out += "\\f"; break;
 			default:
-				// 对于所有非打印字符（ASCII 范围 0–31），用 \uXXXX 转义
-				if (std::iscntrl(c)) {
-					oss << "\\u" << std::setfill('0') << std::setw(4) << std::hex << (0xFF & static_cast<unsigned char>(c));
-				}
-				else {
-					oss << c;  // 正常字符不做转义
-				}
+				// 其余控制字符（ASCII 范围 0–31），用 \uXXXX 转义
+				out += "\\u00";
+				out += hex[c >> 4];
+				out += hex[c & 0xF];
+			}
+		};
+		auto needEscape = [](unsigned char c) {
+			return c < 0x20 || c == '"' || c == '\\';
+		};
+
+		const char* data = input.data();
+		size_t size = input.size();
+		size_t start = 0, i = 0;
+		out.reserve(out.size() + size);
+
+#ifdef IV_SSE2
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i control = _mm_set1_epi8(0x1F);
+		while (i + 16 <= size) {
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			__m128i mask = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+				_mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk)); // 无符号比较 c <= 0x1F
+			unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(mask));
+			if (bits == 0) {
+				i += 16;
+				continue;
 			}
+			i += std::countr_zero(bits);
+			out.append(data + start, i - start);
+			escape(static_cast<unsigned char>(data[i]));
+			start = ++i;
 		}
+#endif
 
-		return oss.str();
+		for (; i < size; ++i) {
+			if (!needEscape(static_cast<unsigned char>(data[i])))
+				continue;
+			out.append(data + start, i - start);
+			escape(static_cast<unsigned char>(data[i]));
+			start = i + 1;
+		}
+		out.append(data + start, size - start);
+	}
+
+	inline std::string escapeJson(const std::string& input) {
+		std::string result;
+		appendEscapedJson(result, input);
+		return result;
 	}
+
 	// 绑定超链接
 	inline std::string linkTo(const std::string& str, const std::string& path, const size_t line) {
 		std::string absolutePath = std::filesystem::absolute(path).string();
@@ -151,4 +203,136 @@ namespace math {
 			throw std::string("异常操作符:" + op);
 		}
 	}
-}
\ No newline at end of file
+}
+
+namespace hash {
+	constexpr uint64_t FnvOffset = 14695981039346656037ull;
+	constexpr uint64_t FnvPrime = 1099511628211ull;
+
+	// 64位FNV-1a哈希, seed用于串联多个字段
+	constexpr uint64_t fnv1a(std::string_view str, uint64_t seed = FnvOffset) {
+		for (unsigned char c : str) {
+			seed ^= c;
+			seed *= FnvPrime;
+		}
+		return seed;
+	}
+
+	// 追加一个字段, 字段之间插入分隔符, 避免"ab"+"c"与"a"+"bc"得到相同结果
+	constexpr uint64_t combine(uint64_t seed, std::string_view str) {
+		return fnv1a(str, (seed ^ 0x1F) * FnvPrime);
+	}
+}
+
+// 节名和键名与游戏一致, 不区分大小写
+// 只折叠ASCII字母, 中文等多字节字符原样比较; 每次处理8字节, 不生成小写副本
+namespace fold {
+	// 8个字节中的大写ASCII字母转为小写, 最高位为1的字节(非ASCII)不变
+	constexpr uint64_t lower8(uint64_t word) {
+		constexpr uint64_t Ones = 0x0101010101010101ull;
+		constexpr uint64_t High = 0x8080808080808080ull;
+		uint64_t heptets = word & ~High;
+		uint64_t atLeastA = heptets + (0x80 - 'A') * Ones;
+		uint64_t aboveZ = heptets + (0x80 - 'Z' - 1) * Ones;
+		return word | ((atLeastA & ~aboveZ & ~word & High) >> 2);
+	}
+
+	constexpr char lower(char c) {
+		return c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+	}
+
+	inline uint64_t load8(const char* data) {
+		uint64_t word;
+		std::memcpy(&word, data, sizeof(word));
+		return word;
+	}
+
+	inline uint64_t hashName(std::string_view str) {
+		uint64_t seed = hash::FnvOffset ^ str.size();
+		size_t i = 0;
+		for (; i + 8 <= str.size(); i += 8) {
+			seed = (seed ^ lower8(load8(str.data() + i))) * hash::FnvPrime;
+			seed ^= seed >> 32;
+		}
+		for (; i < str.size(); ++i)
+			seed = (seed ^ static_cast<unsigned char>(lower(str[i]))) * hash::FnvPrime;
+
+		// 标准库按低位分桶, 最后再混合一次
+		seed ^= seed >> 33;
+		seed *= 0xff51afd7ed558ccdull;
+		seed ^= seed >> 33;
+		return seed;
+	}
+
+	inline bool equal(std::string_view a, std::string_view b) {
+		if (a.size() != b.size())
+			return false;
+		size_t i = 0;
+		for (; i + 8 <= a.size(); i += 8)
+			if (lower8(load8(a.data() + i)) != lower8(load8(b.data() + i)))
+				return false;
+		for (; i < a.size(); ++i)
+			if (lower(a[i]) != lower(b[i]))
+				return false;
+		return true;
+	}
+
+	// 用于unordered_map/unordered_set
+	struct Hash {
+		size_t operator()(const std::string& str) const noexcept { return static_cast<size_t>(hashName(str)); }
+	};
+
+	struct Equal {
+		bool operator()(const std::string& a, const std::string& b) const noexcept { return equal(a, b); }
+	};
+}
+
+// 二进制序列化: 数值按内存布局保存, 字符串为 长度(4字节) + 字节
+// 读取时检查越界, 数据不完整时抛出std::out_of_range
+namespace binary {
+	template<typename T>
+	void write(std::string& buffer, const T& value) {
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	inline void writeString(std::string& buffer, std::string_view str) {
+		write(buffer, static_cast<uint32_t>(str.size()));
+		buffer += str;
+	}
+
+	class Reader {
+	public:
+		explicit Reader(std::string_view bytes) :bytes(bytes) {}
+
+		template<typename T>
+		T read() {
+			T value{ };
+			if (pos + sizeof(T) > bytes.size())
+				throw std::out_of_range("数据不完整");
+			std::memcpy(&value, bytes.data() + pos, sizeof(T));
+			pos += sizeof(T);
+			return value;
+		}
+
+		// 读取元素个数, minSize为每个元素至少占用的字节数; 个数超出剩余数据时视为不完整, 不按损坏的个数分配内存
+		size_t readCount(size_t minSize) {
+			auto count = read<uint32_t>();
+			if (count > (bytes.size() - pos) / minSize)
+				throw std::out_of_range("数据不完整");
+			return count;
+		}
+
+		std::string readString() {
+			auto size = read<uint32_t>();
+			if (size > bytes.size() - pos)
+				throw std::out_of_range("数据不完整");
+			std::string str(bytes.substr(pos, size));
+			pos += size;
+			return str;
+		}
+
+	private:
+		std::string_view bytes;
+		size_t pos{ 0 };
+	};
+}
@@ -1,6 +1,7 @@
 ﻿#include "Helper.h"
 #include "IniFile.h"
 #include "Log.h"
+#include "Profiler.h"
 #include "ProgressBar.h"
 #include <algorithm>
 #include <codecvt>
@@ -15,6 +16,7 @@
 std::vector<std::string> IniFile::FileNames;
 size_t IniFile::FileIndex = ULLONG_MAX;
 std::string IniFile::FileType;
+size_t IniFile::AppendCount = 0;
 
 std::string IniFile::GetFileName(size_t index) {
 	return FileNames.at(index);
@@ -32,7 +34,9 @@ IniFile::IniFile(const std::string& filepath, bool isConfig) :isConfig(isConfig)
 }
 
 void IniFile::load(const std::string& filepath, bool isInclude) {
+	Profiler::Scope profile(Profiler::Category::Phase, "加载文件", filepath);
 	auto path = std::regex_replace(filepath, std::regex("^\"|\"$"), "");
+	files.push_back(path);
 
 	if (!std::filesystem::exists(path)) {
 		Log::out("File not found: {}", path);
@@ -109,6 +113,11 @@ void IniFile::readSection(std::string& currentSection, std::string& line, std::s
 		return;
 	}
 	currentSection = line.substr(1, endPos - 1);
+	// 节中的键值和继承都在读到节名之后修改, 只需在这里记录
+	if (journal && !journal->contains(currentSection)) {
+		auto it = sections.find(currentSection);
+		journal->emplace(currentSection, it != sections.end() ? std::optional<Section>(it->second) : std::nullopt);
+	}
 	sections[currentSection].name = currentSection;
 	sections[currentSection].line = lineNumber;
 	sections[currentSection].fileIndex = FileIndex;
@@ -125,11 +134,8 @@ void IniFile::readKeyValue(std::string& currentSection, std::string& line, std::
 		auto key = string::trim(line.substr(0, delimiterPos));
 		auto value = string::trim(line.substr(delimiterPos + 1));
 		// += 的特殊处理
-		if (key == "+") {
-			static int var_num = 0;
-			key = "var_" + std::to_string(var_num);
-			++var_num;
-		}
+		if (key == "+")
+			key = "var_" + std::to_string(AppendCount++);
 		else if (section.contains(key)) {
 			auto& oldValue = section[key];
 			// 如果现存的值是继承来的值，则不报警，新值覆盖后会去掉继承标签
@@ -147,6 +153,7 @@ void IniFile::readKeyValue(std::string& currentSection, std::string& line, std::
 
 // 处理#include
 void IniFile::processIncludes(const std::string& basePath) {
+	Profiler::Scope profile(Profiler::Category::Phase, "处理include");
 	// 找到名为#include的节
 	if (sections.contains("#include")) {
 		// 遍历#include里的所有键值对，因为unordered_map没有顺序，所以重新按顺序遍历
@@ -167,6 +174,8 @@ void IniFile::processIncludes(const std::string& basePath) {
 void IniFile::processInheritance(std::string& line, size_t endPos, int& lineNumber, std::string& curSectionName) {
 	size_t colonPos = line.find(':', endPos + 1);
 	if (colonPos != std::string::npos) {
+		// 只统计真正有继承的节头, 普通节头不产生统计点和跟踪事件
+		Profiler::Scope profile(Profiler::Category::Phase, "处理继承");
 		// 检查 ':' 之后的第一个字符是否是 '['
 		if (colonPos + 1 >= line.size() || line[colonPos + 1] != '[')
 			return Log::error<_SectionFormat>({ line, GetFileIndex(), lineNumber });
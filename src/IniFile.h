@@ -1,7 +1,16 @@
 ﻿#pragma once
+#include "Helper.h"
 #include <iostream>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 节名、键名不区分大小写, 键保留第一次出现时的写法, 报错时按原样输出
+template<class T>
+using NameMap = std::unordered_map<std::string, T, fold::Hash, fold::Equal>;
+using NameSet = std::unordered_set<std::string, fold::Hash, fold::Equal>;
 
 class Value {
 public:
@@ -48,18 +57,20 @@ public:
 	size_t fileIndex{ };
 	bool isScanned{ };
 	int inheritanceLevel{ };
-	std::unordered_map<Key, Value> section;
+	NameMap<Value> section;
 };
 
 class IniFile {
 public:
-	using Sections = std::unordered_map<std::string, Section>;
+	using Sections = NameMap<Section>;
+	using Journal = NameMap<std::optional<Section>>;
 
 	static std::string GetFileName(size_t index);
 	static size_t GetFileIndex();
 	static std::vector<std::string> FileNames;
 	static size_t FileIndex;
 	static std::string FileType;
+	static size_t AppendCount;	// 已读取的+=键数量, 用于给+=键生成不重复的键名
 
 	IniFile();
 	IniFile(const std::string& filepath, bool isConfig = false);
@@ -70,6 +81,8 @@ public:
 
 	bool isConfig{ false };
 	Sections sections;
+	std::vector<std::string> files;	// 加载过的文件路径, 包括include的文件和不存在的文件, 监视模式据此判断改变的文件
+	Journal* journal{ nullptr };	// 不为空时, 加载中第一次修改某个节前记录其原来的状态, 原来不存在的节记为空, 监视模式据此撤销加载
 private:
 	void processIncludes(const std::string& basePath);
 	void processInheritance(std::string& line, size_t endPos, int& lineNumber, std::string& currentSection);
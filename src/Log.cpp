@@ -1,17 +1,255 @@
 ﻿#include "Log.h"
+#include "Baseline.h"
 #include "Helper.h"
+#include "LogWriter.h"
+#include "OutputBuffer.h"
+#include "Profiler.h"
 #include "ProgressBar.h"
-#include <queue>
+#include "ResultCache.h"
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
+constexpr size_t ConsoleFlushSize = 1 << 16;	// 控制台内容在内存中最多暂存的字节数
+
 Log* Log::Instance = nullptr;
-std::set<LogStream> Log::Logs;
+std::vector<std::unique_ptr<LogBuffer>> Log::Shards;
+std::mutex Log::shardMutex;
+std::mutex Log::spillMutex;
+std::atomic<size_t> Log::MemoryUsage(0);
+std::atomic<size_t> Log::PinnedUsage(0);
+bool Log::DeltaOutput = false;
+thread_local std::vector<LogEntry>* Log::Captured = nullptr;
+thread_local bool Log::CaptureForward = true;
 
 Log::Log() {
 	Instance = this;
 }
 
+Log::~Log() {
+	std::error_code ec;
+	if (!lastOutput.path.empty())
+		std::filesystem::remove(lastOutput.path, ec);
+}
+
+Log::Capture::Capture(std::vector<LogEntry>& target, bool forward) :previous(Captured), previousForward(CaptureForward) {
+	Captured = &target;
+	CaptureForward = forward;
+}
+
+Log::Capture::~Capture() {
+	Captured = previous;
+	CaptureForward = previousForward;
+}
+
+void Log::replay(const std::vector<LogEntry>& entries) {
+	for (const auto& entry : entries)
+		append(entry.severity, entry.data, entry.rule, entry.args);
+}
+
+// 获取当前线程的日志缓冲区, 首次调用时登记到Shards中
+// 缓冲区由Shards持有, 线程退出后其中的日志不会丢失
+LogBuffer& Log::localShard() {
+	thread_local LogBuffer* shard = nullptr;
+	if (!shard) {
+		std::lock_guard<std::mutex> lock(shardMutex);
+		shard = Shards.emplace_back(std::make_unique<LogBuffer>()).get();
+	}
+	return *shard;
+}
+
+// 纯文本日志以唯一的字符串参数保存内容
+void Log::append(Severity severity, const LogData& logdata, std::string content) {
+	std::vector<LogArg> args;
+	args.emplace_back(std::move(content));
+	append(severity, logdata, LogRule::Text, std::move(args));
+}
+
+void Log::append(Severity severity, const LogData& logdata, LogRule rule, std::vector<LogArg> args) {
+	if (Captured) {
+		Captured->push_back({ severity, logdata, rule, args });
+		if (!CaptureForward)
+			return;
+	}
+	ResultCache::record(severity, logdata, rule, args);
+
+	LogRecord record;
+	if (Baseline::Enabled || DeltaOutput)
+		record.fingerprint = fingerprint(rule, logdata, args);
+	if (Baseline::Enabled && Baseline::contains(record.fingerprint)) {
+		++Baseline::Suppressed;
+		return;
+	}
+
+	record.line = logdata.line;
+	record.fileIndex = static_cast<uint32_t>(logdata.fileindex);
+	record.section = StringPool::intern(logdata.section);
+
+	// 同组日志只保存第一条, 其余只在分组表中计数
+	// 分组中的指纹只在更新基线时记录, 无法溢出到磁盘, 计入PinnedUsage
+	if (Aggregator::Enabled) {
+		record.group = groupKey(severity, rule, args);
+		uint64_t fingerprint = Baseline::Update ? record.fingerprint : 0;
+		bool first = Aggregator::add(record.group, { record.fileIndex, record.line, record.section }, fingerprint);
+		if (fingerprint) {
+			MemoryUsage.fetch_add(sizeof(fingerprint), std::memory_order_relaxed);
+			PinnedUsage.fetch_add(sizeof(fingerprint), std::memory_order_relaxed);
+		}
+		if (!first)
+			return;
+	}
+
+	record.rule = rule;
+	record.severity = static_cast<uint8_t>(severity);
+	record.isSectionName = logdata.isSectionName;
+
+	// 用量在缓冲区的锁内增加, 溢出时减去的字节数与之一致
+	auto& shard = localShard();
+	size_t usage;
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto bytes = shard.append(record, logdata.origin, args);
+		usage = MemoryUsage.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	}
+
+	// 检查结果缓存和分组指纹也计入上限, 但无法溢出; 它们占满上限时日志仍保留limit/4的空间, 避免每条日志都触发溢出
+	size_t limit = Settings::Instance ? Settings::Instance->logMemoryLimit << 20 : 0;
+	if (!limit)
+		return;
+	size_t cache = ResultCache::MemoryUsage.load(std::memory_order_relaxed);
+	size_t pinned = PinnedUsage.load(std::memory_order_relaxed);
+	size_t ceiling = (std::max)(limit, cache + pinned + limit / 4);
+	if (usage + cache > ceiling)
+		spill(ceiling - limit / 4 - cache);
+}
+
+// 从最大的缓冲区开始写入临时文件, 直到用量降到watermark以下, 留出余量后之后的日志不会每条都触发溢出
+// 同时只有一个线程执行溢出, 其余超过上限的线程在此等待, 不会在溢出期间继续占用内存
+void Log::spill(size_t watermark) {
+	std::lock_guard<std::mutex> spilling(spillMutex);
+
+	std::vector<std::pair<size_t, LogBuffer*>> shards;
+	{
+		std::lock_guard<std::mutex> lock(shardMutex);
+		for (const auto& shard : Shards) {
+			std::lock_guard<std::mutex> shardLock(shard->mutex);
+			shards.emplace_back(shard->bytes(), shard.get());
+		}
+	}
+	std::sort(shards.begin(), shards.end(), [](const auto& l, const auto& r) { return l.first > r.first; });
+
+	for (const auto& [_, shard] : shards) {
+		if (MemoryUsage.load(std::memory_order_relaxed) <= watermark)
+			break;
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		MemoryUsage.fetch_sub(shard->bytes(), std::memory_order_relaxed);
+		shard->spill();
+	}
+}
+
+// 计算基线指纹: 规则 + 文件名 + 节名 + 键 + 规范化后的值 + 字符串参数, 不包含行号
+// 原文是节头或没有键时(例如重复的键、未使用的全局节), 同一节的多条日志只能靠参数区分
+// 数字参数可能是行号, 不参与计算
+uint64_t Log::fingerprint(LogRule rule, const LogData& logdata, const std::vector<LogArg>& args) {
+	// 去除注释和空白并转为小写, 使格式上的修改不影响指纹
+	auto normalize = [](std::string_view str) {
+		std::string result;
+		for (char c : str.substr(0, str.find(';')))
+			if (!std::isspace(static_cast<unsigned char>(c)))
+				result += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return result;
+	};
+
+	uint64_t hash = hash::combine(hash::FnvOffset, LogRuleNames[static_cast<size_t>(rule)]);
+	hash = hash::combine(hash, logdata.fileindex < IniFile::FileNames.size() ? IniFile::FileNames[logdata.fileindex] : "");
+	hash = hash::combine(hash, logdata.section);
+
+	std::string_view origin = logdata.origin;
+	auto delimiterPos = origin.find('=');
+	if (!logdata.section.empty() && !logdata.isSectionName && delimiterPos != std::string_view::npos) {
+		hash = hash::combine(hash, normalize(origin.substr(0, delimiterPos)));
+		hash = hash::combine(hash, normalize(origin.substr(delimiterPos + 1)));
+	}
+	else if (!origin.empty())
+		hash = hash::combine(hash, normalize(origin));
+	if (rule != LogRule::Text)
+		for (const auto& arg : args)
+			if (auto str = std::get_if<std::string>(&arg))
+				hash = hash::combine(hash, normalize(*str));
+
+	// 纯文本日志(例如脚本的报错)的内容本身也参与计算
+	if (rule == LogRule::Text && !args.empty())
+		hash = hash::combine(hash, std::get<std::string>(args.front()));
+	return hash;
+}
+
+// 计算聚合分组: 级别 + 规则 + 参数, 三者相同则日志文本相同
+// 纯文本日志以内容作为唯一的参数, 同样适用
+uint64_t Log::groupKey(Severity severity, LogRule rule, const std::vector<LogArg>& args) {
+	auto bytes = [](const auto& value) {
+		return std::string_view(reinterpret_cast<const char*>(&value), sizeof(value));
+	};
+
+	uint64_t hash = hash::combine(hash::FnvOffset, bytes(severity));
+	hash = hash::combine(hash, bytes(rule));
+	for (const auto& arg : args) {
+		hash = hash::combine(hash, bytes(arg.index()));
+		std::visit([&](const auto& value) {
+			if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string>)
+				hash = hash::combine(hash, value);
+			else
+				hash = hash::combine(hash, bytes(value));
+		}, arg);
+	}
+	// 0保留为未聚合
+	return hash ? hash : 1;
+}
+
+// 归并所有缓冲区和临时文件中的记录, 按LogRecord::less的顺序依次交给func, 之后清空所有日志
+// 内存中的记录先并行排序, 临时文件在写入时已排序, 归并过程只需为每个来源保留一条记录
+template<typename Func>
+void Log::merge(Func&& func) {
+	std::lock_guard<std::mutex> lock(shardMutex);
+
+	// 记录段过多时先分批归并成更大的段, 使同时打开的文件不超过MaxFanIn
+	// 所有段都交给第一个缓冲区管理, 中途出错时仍由它删除
+	if (!Shards.empty()) {
+		auto& runs = Shards.front()->runs;
+		for (size_t i = 1; i < Shards.size(); ++i) {
+			runs.insert(runs.end(), Shards[i]->runs.begin(), Shards[i]->runs.end());
+			Shards[i]->runs.clear();
+		}
+		while (runs.size() > LogBuffer::MaxFanIn) {
+			std::vector<std::filesystem::path> batch(runs.begin(), runs.begin() + LogBuffer::MaxFanIn);
+			runs.push_back(LogBuffer::tempPath());
+			LogBuffer::mergeRuns(batch, runs.back());
+			runs.erase(runs.begin(), runs.begin() + batch.size());
+			std::error_code ec;
+			for (const auto& run : batch)
+				std::filesystem::remove(run, ec);
+		}
+	}
+
+	std::vector<LogCursor> cursors;
+	for (auto& shard : Shards) {
+		shard->sort();
+		for (const auto& run : shard->runs)
+			cursors.emplace_back(run);
+		cursors.emplace_back(*shard);
+	}
+
+	mergeCursors(cursors, [&func](const LogCursor& cursor) {
+		LogStream log(cursor.record(), cursor.payload());
+		func(log);
+	});
+
+	cursors.clear();
+	for (auto& shard : Shards)
+		shard->clear();
+	MemoryUsage = 0;
+	PinnedUsage = 0;
+}
+
 std::string Log::getSeverityLabel(Severity severity) {
 	switch (severity) {
 	case Severity::DEFAULT: return "";
@@ -43,76 +281,180 @@ std::string Log::getJsonSeverityLabel(Severity severity) {
 }
 
 void Log::output() {
-	bool jsonLog = Settings::Instance->jsonLog;
-	const std::string& logFileName = jsonLog ? "Checker.json" : "Checker.log";
+	Profiler::Scope profile(Profiler::Category::Phase, "输出日志");
+	auto logFormat = Settings::Instance->logFormat;
+	std::string logFileName = LogWriter::GetFileName(logFormat);
 	Progress::stop();
-	// 共享资源和同步机制
-	std::queue<std::string> logQueue;
-	std::mutex queueMutex, fileMutex;
-	std::condition_variable cv;
-	bool stopFlag = false;
 
 	// 打开文件
 	std::ofstream logFile(logFileName, std::ios::out | std::ios::trunc);
 	if (!logFile.is_open())
 		throw std::runtime_error("Unable to open log file: " + logFileName);
 
-	// 写日志线程
-	std::thread writerThread([&]() {
-		while (true) {
-			std::string log;
-			{
-				std::unique_lock<std::mutex> lock(queueMutex);
-				cv.wait(lock, [&]() { return stopFlag || !logQueue.empty(); });
-
-				if (stopFlag && logQueue.empty()) break; // 如果停止标志设定且队列为空，退出线程
-				log = logQueue.front();
-				logQueue.pop();
-			}
-
-			// 写日志到文件（受 fileMutex 保护）
-			{
-				std::lock_guard<std::mutex> lock(fileMutex);
-				logFile << log << std::endl;
-			}
+	// 逐条归并日志: 写入日志文件, 统计数量, 并暂存前ConsoleLimit条控制台内容
+	// 控制台内容要在统计表之后输出, 超过ConsoleFlushSize的部分先写入临时文件, 内存中只保留一块
+	LogWriter writer(logFile, logFormat);
+	std::map<size_t, std::map<Severity, int>> fileIndexSeverityCount;
+	std::vector<uint64_t> fingerprints;
+	std::string console;
+	std::filesystem::path consolePath;
+	std::fstream consoleFile;
+	auto spoolConsole = [&] {
+		if (!consoleFile.is_open()) {
+			consolePath = LogBuffer::tempPath();
+			consoleFile.open(consolePath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!consoleFile.is_open())
+				throw std::runtime_error("无法写入临时文件: " + consolePath.string());
 		}
-	});
-
-	if (jsonLog)
-		logQueue.push("[");
-	// 将日志放入队列
-	for (const auto& log : Logs) {
-		{
-			std::lock_guard<std::mutex> lock(queueMutex);
-			if (jsonLog) {
-				auto& back = *std::prev(Logs.end());
-				logQueue.push(log.getJsonLog(&log == &back));
-			}
+		consoleFile.write(console.data(), console.size());
+		console.clear();
+	};
+	size_t consoleLimit = Settings::Instance->consoleLimit;
+	size_t total = 0, printCount = 0;
+	// 只输出变化时, 第一次检查仍完整输出
+	bool printDelta = DeltaOutput && hasLastOutput;
+	PrintedLogs current;
+	std::ofstream messageFile;
+	if (DeltaOutput) {
+		current.path = LogBuffer::tempPath();
+		messageFile.open(current.path, std::ios::binary | std::ios::trunc);
+		if (!messageFile.is_open())
+			throw std::runtime_error("无法写入临时文件: " + current.path.string());
+	}
+	OutputBuffer messages(messageFile, ConsoleFlushSize);
+	uint64_t messageOffset = 0;
+
+	writer.begin();
+	merge([&](LogStream& log) {
+		log.render();
+		writer.write(log);
+		// 聚合后的日志按出现次数统计, 全部计入第一条所在的文件
+		fileIndexSeverityCount[log.data.fileindex][log.severity] += log.group ? static_cast<int>(log.group->count) : 1;
+		if (Baseline::Update) {
+			if (log.group)
+				fingerprints.insert(fingerprints.end(), log.group->fingerprints.begin(), log.group->fingerprints.end());
 			else
-				logQueue.push(log.getFileMessage());
+				fingerprints.push_back(log.getFingerprint());
 		}
-		cv.notify_one(); // 通知写线程
-	}
+		if (DeltaOutput) {
+			auto& printed = current.logs[log.getFingerprint()];
+			if (printed.count++ == 0) {
+				auto& out = messages.str();
+				auto begin = out.size();
+				log.appendPrintMessage(out);
+				printed.order = current.logs.size();
+				printed.offset = messageOffset;
+				printed.size = out.size() - begin;
+				messageOffset += printed.size;
+				messages.commit();
+			}
+		}
+		if (!printDelta && (!consoleLimit || printCount < consoleLimit)) {
+			log.appendPrintMessage(console);
+			console += '\n';
+			++printCount;
+			if (console.size() >= ConsoleFlushSize)
+				spoolConsole();
+		}
+		++total;
+	});
+	writer.end();
+	logFile.close();
+	messages.flush();
+	messageFile.close();
+	Aggregator::clear();
+	StringPool::clear();
+	Baseline::save(fingerprints);
 
-	// 打印到控制台
+	// 先输出统计表
 	std::map<std::string, std::map<Severity, int>> fileSeverityCount;
-	for (const auto& log : Logs) {
-		auto filename = IniFile::GetFileName(log.data.fileindex);
-		fileSeverityCount[filename][log.severity]++;
-		std::cerr << log.getPrintMessage() << std::endl;
-	}
+	for (const auto& [fileIndex, severityCount] : fileIndexSeverityCount)
+		for (const auto& [severity, count] : severityCount)
+			fileSeverityCount[IniFile::GetFileName(fileIndex)][severity] += count;
 	summary(fileSeverityCount);
+	// 每次检查单独计数
+	if (Baseline::Suppressed)
+		std::cerr << std::format("已忽略{}条基线中的已知问题\n", Baseline::Suppressed.exchange(0));
+	if (ResultCache::Hits)
+		std::cerr << std::format("{}个节有改动, 其余节中的{}个使用了上次的检查结果\n", ResultCache::Changed, ResultCache::Hits);
+
+	// 打印到控制台，最多输出ConsoleLimit条，其余的只写入日志文件
+	if (consoleFile.is_open()) {
+		consoleFile.seekg(0);
+		std::string chunk(ConsoleFlushSize, '\0');
+		while (consoleFile.read(chunk.data(), chunk.size()) || consoleFile.gcount())
+			std::cerr.write(chunk.data(), consoleFile.gcount());
+		consoleFile.close();
+		std::error_code ec;
+		std::filesystem::remove(consolePath, ec);
+	}
+	if (printDelta)
+		delta(lastOutput, current, consoleLimit);
+	else if (printCount < total)
+		console += std::format("\n另有{}条日志未在控制台显示，详见{}\n", total - printCount, logFileName);
+	std::cerr.write(console.data(), console.size());
+
+	if (DeltaOutput) {
+		std::error_code ec;
+		if (!lastOutput.path.empty())
+			std::filesystem::remove(lastOutput.path, ec);
+		lastOutput.logs = std::move(current.logs);
+		lastOutput.path = current.path;
+		hasLastOutput = true;
+	}
+}
 
-	// 设置停止标志并等待线程完成
-	{
-		std::lock_guard<std::mutex> lock(queueMutex);
-		stopFlag = true;
+// 按指纹比较两次输出, 同一指纹的条数增加或减少时, 按差值输出新增或消失的条数
+// 新增的日志按本次的顺序、消失的日志按上次的顺序输出, 即都按文件和行号排列
+void Log::delta(const PrintedLogs& previous, const PrintedLogs& current, size_t limit) {
+	using Change = std::pair<const Printed*, size_t>;
+	auto compare = [](const PrintedLogs& from, const PrintedLogs& to) {
+		std::vector<Change> changes;
+		for (const auto& [fingerprint, printed] : from.logs) {
+			auto it = to.logs.find(fingerprint);
+			size_t count = it != to.logs.end() ? it->second.count : 0;
+			if (printed.count > count)
+				changes.emplace_back(&printed, printed.count - count);
+		}
+		std::sort(changes.begin(), changes.end(), [](const Change& l, const Change& r) { return l.first->order < r.first->order; });
+		return changes;
+	};
+	auto added = compare(current, previous);
+	auto removed = compare(previous, current);
+
+	size_t addedCount = 0, removedCount = 0;
+	for (const auto& [_, count] : added)
+		addedCount += count;
+	for (const auto& [_, count] : removed)
+		removedCount += count;
+	OutputBuffer out(std::cerr, ConsoleFlushSize);
+	if (!addedCount && !removedCount) {
+		out << "\n与上次检查相比没有变化\n";
+		return;
 	}
-	cv.notify_all(); // 通知线程退出
-	writerThread.join();
 
-	// 关闭文件
-	logFile.close();
+	out << std::format("\n与上次检查相比新增{}条, 消失{}条\n", addedCount, removedCount);
+	// 变化按order排列, 即按写入顺序读取临时文件
+	size_t printCount = 0;
+	std::string message;
+	auto print = [&](const std::vector<Change>& changes, const PrintedLogs& source, std::string_view sign) {
+		std::ifstream file(source.path, std::ios::binary);
+		for (const auto& [printed, count] : changes) {
+			if (limit && printCount >= limit)
+				break;
+			message.resize(printed->size);
+			file.seekg(printed->offset);
+			file.read(message.data(), message.size());
+			for (size_t i = 0; i < count && (!limit || printCount < limit); ++i, ++printCount) {
+				out << sign << message << '\n';
+				out.commit();
+			}
+		}
+	};
+	print(added, current, "\033[32m+\033[0m ");
+	print(removed, previous, "\033[31m-\033[0m ");
+	if (printCount < addedCount + removedCount)
+		out << std::format("\n另有{}条变化未在控制台显示\n", addedCount + removedCount - printCount);
 }
 
 void Log::summary(std::map<std::string, std::map<Severity, int>>& fileSeverityCount) {
@@ -167,34 +509,67 @@ void Log::writeLog(const std::string& logLine) {
 		logFile << logLine << std::endl;
 }
 
-LogStream::LogStream(Severity severity, const LogData& logdata, std::string buffer)
-	: severity(severity), data(logdata), buffer(buffer) {}
+// 从定长记录还原出完整的日志, 仅在输出时使用
+LogStream::LogStream(const LogRecord& record, std::string_view payload)
+	: severity(static_cast<Severity>(record.severity)), rule(record.rule), args(LogRecord::decodeArgs(record.args(payload))), fingerprint(record.fingerprint) {
+	data.line = record.line;
+	data.fileindex = record.fileIndex;
+	data.section = StringPool::get(record.section);
+	data.origin = record.origin(payload);
+	data.isSectionName = record.isSectionName;
+	if (record.group)
+		group = Aggregator::find(record.group);
+	if (rule == LogRule::Text && !this->args.empty()) {
+		buffer = std::get<std::string>(std::move(this->args.front()));
+		this->args.clear();
+	}
+}
+
+// 使用预编译模板生成日志内容, 只对实际输出的日志调用
+void LogStream::render() {
+	if (rule == LogRule::Text || !buffer.empty())
+		return;
 
-std::string LogStream::getFileMessage() const {
-	std::ostringstream plainMessage;
-	plainMessage << Log::getPlainSeverityLabel(severity) << " " << generateLogMessage(false);
-	return plainMessage.str();
+	const auto& format = Settings::Instance->getTemplate(rule);
+	try {
+		buffer = format.render(args);
+	}
+	catch (const std::format_error& e) {
+		buffer = Settings::Instance->*LogRuleMembers[static_cast<size_t>(rule)];
+		std::cerr << "格式错误：" << e.what() << "\n日志模板：" << buffer << std::endl;
+	}
+	args.clear();
 }
 
-std::string LogStream::getPrintMessage() const {
-	std::ostringstream formattedMessage;
-	formattedMessage << Log::getSeverityLabel(severity) << " " << generateLogMessage(true);
-	return formattedMessage.str();
+void LogStream::appendFileMessage(std::string& out) const {
+	out += Log::getPlainSeverityLabel(severity);
+	out += ' ';
+	out += generateLogMessage(false);
+	appendLocations(out);
 }
 
-std::string LogStream::getJsonLog(bool isLast) const {
-	std::ostringstream jsonStream;
-	jsonStream << "\t{\n"
-		<< "\t\t\"filename\": \"" << IniFile::GetFileName(data.fileindex) << "\",\n"
-		<< "\t\t\"line\": " << data.line << ",\n"
-		<< "\t\t\"section\": \"" << data.section << "\",\n"
-		//<< "\t\t\"origin\": \"" << data.origin << "\",\n"
-		<< "\t\t\"level\": \"" << Log::getJsonSeverityLabel(severity) << "\",\n"
-		<< "\t\t\"message\": \"" << string::escapeJson(buffer) << "\"\n"
-		<< "\t}"
-		<< (isLast ? "\n]" : ",");
-	
-	return jsonStream.str();
+void LogStream::appendPrintMessage(std::string& out) const {
+	out += Log::getSeverityLabel(severity);
+	out += ' ';
+	out += generateLogMessage(true);
+	appendLocations(out);
+}
+
+// 聚合后的日志在末尾附上出现次数和前几处位置
+void LogStream::appendLocations(std::string& out) const {
+	if (!group || group->count <= 1)
+		return;
+
+	out += std::format("\n[汇总] 共出现{}次", group->count);
+	for (const auto& location : group->locations) {
+		out += std::format("\n\t{} ", IniFile::GetFileName(location.fileIndex));
+		if (location.line >= 0)
+			out += std::format("第{}行 ", location.line);
+		if (auto section = StringPool::get(location.section); !section.empty())
+			out += std::format("[{}]", section);
+	}
+	if (group->count > group->locations.size())
+		out += std::format("\n\t... 其余{}处未列出", group->count - group->locations.size());
 }
 
 std::string LogStream::generateLogMessage(bool isFormatted) const {
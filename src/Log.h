@@ -1,11 +1,16 @@
 ﻿#pragma once
+#include "Aggregator.h"
 #include "IniFile.h"
+#include "LogBuffer.h"
 #include "Settings.h"
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <set>
+#include <unordered_map>
+#include <vector>
 
 // 日志级别
 enum class Severity : int {
@@ -38,18 +43,47 @@ struct LogData {
 	}
 };
 
+// 产生日志时的完整参数, 用于原样重新产生同一条日志
+struct LogEntry {
+	Severity severity;
+	LogData data;
+	LogRule rule;
+	std::vector<LogArg> args;
+};
+
 // 日志类
 class LogStream;
+class LogWriter;
+class ResultCache;
 class Log {
 public:
 	friend LogStream;
+	friend LogWriter;
+	friend ResultCache;
 	static Log* Instance;
-	static std::set<LogStream> Logs;
 
 	Log();
+	~Log();
 
 	void output();
 
+	// 记录当前线程在作用域内产生的日志, 例如加载文件时的格式错误, 文件未改变时用replay重新产生而不必再次解析
+	// forward为false时日志只记录不输出, 由调用者稍后在别处replay, 例如并行检查的结果按批次顺序输出
+	class Capture {
+	public:
+		explicit Capture(std::vector<LogEntry>& target, bool forward = true);
+		~Capture();
+		Capture(const Capture&) = delete;
+		Capture& operator=(const Capture&) = delete;
+
+	private:
+		std::vector<LogEntry>* previous;
+		bool previousForward;
+	};
+	static void replay(const std::vector<LogEntry>& entries);
+
+	static bool DeltaOutput;	// 控制台只输出与上次相比新增和消失的日志, 按基线指纹比较, 行号变化不算新日志
+
 	// 直接输出文本的形式，禁止不填内容，只填1个字符串时直接输出字符串
 	// 填入多个变量时，第一个变量为format，后续的变量为格式化参数
 	template<typename... Args>
@@ -86,13 +120,46 @@ private:
 	void writeLog(const std::string& log);
 	void summary(std::map<std::string, std::map<Severity, int>>& fileSeverityCount);
 
+	// 上次输出的日志: 指纹 <-> 条数和控制台内容的位置, 用于DeltaOutput
+	// 控制台内容写入临时文件, 内存中每个指纹只占固定大小, 不随日志文本增长
+	struct Printed {
+		size_t count{ 0 };
+		size_t order{ 0 };		// 第一次出现的顺序
+		uint64_t offset{ 0 };	// 控制台内容在临时文件中的位置
+		size_t size{ 0 };
+	};
+	struct PrintedLogs {
+		std::unordered_map<uint64_t, Printed> logs;
+		std::filesystem::path path;	// 每个指纹第一条日志的控制台内容, 按order顺序写入
+	};
+	PrintedLogs lastOutput;
+	bool hasLastOutput{ false };
+	static void delta(const PrintedLogs& previous, const PrintedLogs& current, size_t limit);	// 直接分块写入控制台
+	static thread_local std::vector<LogEntry>* Captured;
+	static thread_local bool CaptureForward;
+
+	// 每个线程独占一个只追加的日志缓冲区, 写入时只锁自己的缓冲区, 输出前由merge统一归并
+	static std::vector<std::unique_ptr<LogBuffer>> Shards;
+	static std::mutex shardMutex;
+	static std::mutex spillMutex;
+	static std::atomic<size_t> MemoryUsage;	// 所有缓冲区占用的字节数, 超过LogMemoryLimit时溢出到磁盘
+	static std::atomic<size_t> PinnedUsage;	// MemoryUsage中无法溢出的部分(聚合分组记录的指纹)
+	static LogBuffer& localShard();
+	static void spill(size_t watermark);
+	static void append(Severity severity, const LogData& logdata, std::string content);
+	static void append(Severity severity, const LogData& logdata, LogRule rule, std::vector<LogArg> args);
+	static uint64_t fingerprint(LogRule rule, const LogData& logdata, const std::vector<LogArg>& args);
+	static uint64_t groupKey(Severity severity, LogRule rule, const std::vector<LogArg>& args);
+	template<typename Func>
+	static void merge(Func&& func);
+
 	// Member是Settings中定义的字符串，为0时代表直接输出文本
+	// 模板日志只记录规则编号与参数, 到输出时才格式化
 	template <auto Member, typename... Args>
 	static void stream(Severity severity, const LogData& logdata, Args&&... args) {
-		try {
-			if constexpr (Member == 0) {
-				static_assert(sizeof...(Args) > 0, "不允许不写参数的直接LOG输出");
-
+		if constexpr (Member == 0) {
+			static_assert(sizeof...(Args) > 0, "不允许不写参数的直接LOG输出");
+			try {
 				if constexpr (sizeof...(Args) > 1) {
 					auto tuple = std::make_tuple(std::forward<Args>(args)...);
 					auto content = std::apply(
@@ -100,51 +167,51 @@ private:
 						return std::vformat(first, std::make_format_args(rest...));
 					},
 						tuple);
-					Log::Logs.emplace(severity, logdata, content);
+					append(severity, logdata, std::move(content));
 				}
 				else {
 					auto content = std::vformat("{}", std::make_format_args(args...));
-					Log::Logs.emplace(severity, logdata, content);
+					append(severity, logdata, std::move(content));
 				}
 			}
-			else {
-				if (Settings::Instance && !(Settings::Instance->*Member).empty()) {
-					auto content = std::vformat(Settings::Instance->*Member, std::make_format_args(args...));
-					Log::Logs.emplace(severity, logdata, content);
-				}
+			catch (const std::format_error& e) {
+				std::cerr << "格式错误：" << e.what() << "\n输入参数：";
+				((std::cerr << args << " "), ...);
+				std::cerr << std::endl;
 			}
 		}
-		catch (const std::format_error& e) {
-			std::cerr << "格式错误：" << e.what() << "\n输入参数：";
-
-			if constexpr (Member != 0) 
-				std::cerr << Settings::Instance->*Member << " ";
-
-			((std::cerr << args << " "), ...);
-			std::cerr << std::endl;
+		else {
+			constexpr auto rule = getLogRule<Member>();
+			static_assert(rule != LogRule::Text, "Member必须是LOG_RULES中登记的规则");
+			if (Settings::Instance && !(Settings::Instance->*Member).empty())
+				append(severity, logdata, rule, { LogTemplate::makeArg(args)... });
 		}
 	}
 };
 
-// 日志条
+// 日志条, 由LogRecord还原而来, 仅在输出时使用
 class LogStream {
 public:
 	friend Log;
+	friend LogWriter;
 	explicit LogStream() = default;
-	LogStream(Severity severity, const LogData& logdata, std::string buffer);
+	LogStream(const LogRecord& record, std::string_view payload);
 
-	std::string getFileMessage() const;
-	std::string getPrintMessage() const;
+	void render();
+	uint64_t getFingerprint() const { return fingerprint; }
 
-	bool operator<(const LogStream& r) const {
-		return data < r.data;
-	}
+	void appendFileMessage(std::string& out) const;
+	void appendPrintMessage(std::string& out) const;
 
 private:
-	std::string getJsonLog(bool isLast) const;
 	std::string generateLogMessage(bool isFormatted) const;
+	void appendLocations(std::string& out) const;
 
 	Severity severity;
 	LogData data;
+	LogRule rule{ LogRule::Text };	// 为Text时args中只有一个字符串, 即日志内容
+	std::vector<LogArg> args;		// 模板参数, render之后清空
 	std::string buffer;
+	uint64_t fingerprint{ };		// 基线指纹, 仅在启用基线或DeltaOutput时计算
+	const Aggregator::Group* group{ };	// 聚合分组, 未启用聚合时为空
 };
\ No newline at end of file
@@ -0,0 +1,215 @@
+﻿#include "LogBuffer.h"
+#include "OutputBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <execution>
+#include <format>
+#include <mutex>
+#include <random>
+
+std::shared_mutex StringPool::mutex;
+std::deque<std::string> StringPool::strings{ "" };
+std::unordered_map<std::string_view, uint32_t> StringPool::ids{ { strings.front(), 0 } };
+
+uint32_t StringPool::intern(std::string_view str) {
+	if (str.empty())
+		return 0;
+
+	{
+		std::shared_lock lock(mutex);
+		auto it = ids.find(str);
+		if (it != ids.end())
+			return it->second;
+	}
+
+	std::unique_lock lock(mutex);
+	auto it = ids.find(str);
+	if (it != ids.end())
+		return it->second;
+
+	auto id = static_cast<uint32_t>(strings.size());
+	ids.emplace(strings.emplace_back(str), id);
+	return id;
+}
+
+const std::string& StringPool::get(uint32_t id) {
+	std::shared_lock lock(mutex);
+	return strings[id];
+}
+
+// 只能在没有日志记录引用池中编号时调用, 即所有日志输出之后
+void StringPool::clear() {
+	std::unique_lock lock(mutex);
+	ids.clear();
+	strings.resize(1);
+	ids.emplace(strings.front(), 0);
+}
+
+bool LogRecord::less(const LogRecord& l, std::string_view lPayload, const LogRecord& r, std::string_view rPayload) {
+	if (l.fileIndex != r.fileIndex) return l.fileIndex < r.fileIndex;
+	if (l.line != r.line) return l.line < r.line;
+	if (l.rule != r.rule) return l.rule < r.rule;
+	if (l.severity != r.severity) return l.severity < r.severity;
+	if (auto lOrigin = l.origin(lPayload), rOrigin = r.origin(rPayload); lOrigin != rOrigin) return lOrigin < rOrigin;
+	if (auto lArgs = l.args(lPayload), rArgs = r.args(rPayload); lArgs != rArgs) return lArgs < rArgs;
+	if (l.isSectionName != r.isSectionName) return l.isSectionName < r.isSectionName;
+	// 字符串池中相同的字符串编号相同, 编号不同时才比较内容
+	if (l.section != r.section) return StringPool::get(l.section) < StringPool::get(r.section);
+	return false;
+}
+
+// 参数按 类型(1字节) + 内容 依次写入, 字符串内容为 长度(4字节) + 字节
+void LogRecord::encodeArgs(std::string& arena, const std::vector<LogArg>& args) {
+	for (const auto& arg : args) {
+		arena += static_cast<char>(arg.index());
+		std::visit([&](const auto& value) {
+			using T = std::decay_t<decltype(value)>;
+			if constexpr (std::is_same_v<T, std::string>) {
+				auto size = static_cast<uint32_t>(value.size());
+				arena.append(reinterpret_cast<const char*>(&size), sizeof(size));
+				arena += value;
+			}
+			else
+				arena.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		}, arg);
+	}
+}
+
+std::vector<LogArg> LogRecord::decodeArgs(std::string_view bytes) {
+	std::vector<LogArg> args;
+	size_t pos = 0;
+	auto read = [&](auto& value) {
+		std::memcpy(&value, bytes.data() + pos, sizeof(value));
+		pos += sizeof(value);
+	};
+
+	while (pos < bytes.size()) {
+		auto type = static_cast<size_t>(bytes[pos++]);
+		switch (type) {
+		case 0: { long long value; read(value); args.emplace_back(value); break; }
+		case 1: { unsigned long long value; read(value); args.emplace_back(value); break; }
+		case 2: { float value; read(value); args.emplace_back(value); break; }
+		case 3: { double value; read(value); args.emplace_back(value); break; }
+		case 4: {
+			uint32_t size;
+			read(size);
+			args.emplace_back(std::string(bytes.substr(pos, size)));
+			pos += size;
+			break;
+		}
+		default:
+			return args;
+		}
+	}
+	return args;
+}
+
+LogBuffer::~LogBuffer() {
+	clear();
+}
+
+// 追加一条记录, 返回新增的字节数
+size_t LogBuffer::append(LogRecord record, std::string_view origin, const std::vector<LogArg>& args) {
+	record.offset = static_cast<uint32_t>(arena.size());
+	record.originSize = static_cast<uint32_t>(origin.size());
+	arena += origin;
+	auto before = arena.size();
+	LogRecord::encodeArgs(arena, args);
+	record.argSize = static_cast<uint32_t>(arena.size() - before);
+	records.push_back(record);
+	return sizeof(LogRecord) + record.payloadSize();
+}
+
+void LogBuffer::sort() {
+	std::sort(std::execution::par, records.begin(), records.end(), [this](const LogRecord& l, const LogRecord& r) {
+		return LogRecord::less(l, payload(l), r, payload(r));
+	});
+}
+
+std::filesystem::path LogBuffer::tempPath() {
+	static std::atomic<size_t> index(0);
+	static const auto token = std::random_device{}();
+	return std::filesystem::temp_directory_path() / std::format("INIValidator_{:08x}_{}.tmp", token, index++);
+}
+
+// 排序后写入临时文件, 每条为 记录 + 原文 + 参数, 读取时可顺序解析
+void LogBuffer::spill() {
+	sort();
+	auto path = tempPath();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("无法写入临时文件: " + path.string());
+
+	{
+		OutputBuffer out(file);
+		for (const auto& record : records) {
+			out << std::string_view(reinterpret_cast<const char*>(&record), sizeof(record));
+			out << payload(record);
+			out.commit();
+		}
+	}
+
+	// 释放容量, 已溢出的缓冲区不再占用内存
+	runs.push_back(path);
+	records = {};
+	arena = {};
+}
+
+// 将多个有序记录段归并写入output, 格式与spill相同; 不删除输入文件
+void LogBuffer::mergeRuns(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output) {
+	std::ofstream file(output, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("无法写入临时文件: " + output.string());
+
+	std::vector<LogCursor> cursors;
+	cursors.reserve(inputs.size());
+	for (const auto& input : inputs)
+		cursors.emplace_back(input);
+
+	OutputBuffer out(file);
+	mergeCursors(cursors, [&out](const LogCursor& cursor) {
+		out << std::string_view(reinterpret_cast<const char*>(&cursor.record()), sizeof(LogRecord));
+		out << cursor.payload();
+		out.commit();
+	});
+}
+
+// 清空记录并删除临时文件
+void LogBuffer::clear() {
+	records.clear();
+	arena.clear();
+	std::error_code ec;
+	for (const auto& run : runs)
+		std::filesystem::remove(run, ec);
+	runs.clear();
+}
+
+LogCursor::LogCursor(const LogBuffer& buffer) : buffer(&buffer) {}
+
+LogCursor::LogCursor(const std::filesystem::path& run) : path(run), file(run, std::ios::binary) {
+	if (!file.is_open())
+		throw std::runtime_error("无法读取临时文件: " + run.string());
+}
+
+bool LogCursor::next() {
+	if (buffer) {
+		if (index >= buffer->records.size())
+			return false;
+		current = buffer->records[index++];
+		currentPayload = buffer->payload(current);
+		return true;
+	}
+
+	// 文件正好在记录边界结束才是正常结束, 读到一半说明临时文件被截断
+	if (!file.read(reinterpret_cast<char*>(&current), sizeof(current))) {
+		if (file.gcount() == 0)
+			return false;
+		throw std::runtime_error("临时文件不完整: " + path.string());
+	}
+	filePayload.resize(current.payloadSize());
+	if (!file.read(filePayload.data(), filePayload.size()))
+		throw std::runtime_error("临时文件不完整: " + path.string());
+	currentPayload = filePayload;
+	return true;
+}
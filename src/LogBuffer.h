@@ -0,0 +1,123 @@
+﻿#pragma once
+#include "LogTemplate.h"
+#include "Settings.h"
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 字符串池: 节名在日志中大量重复, 只保存一份, 日志中只记录编号
+// 编号0固定为空字符串; 每次输出日志后清空, 不会随反复检查增长
+class StringPool {
+public:
+	static uint32_t intern(std::string_view str);
+	static const std::string& get(uint32_t id);
+	static void clear();
+
+private:
+	static std::shared_mutex mutex;
+	static std::deque<std::string> strings;							// deque扩容时不会移动已有元素
+	static std::unordered_map<std::string_view, uint32_t> ids;		// 键指向strings中的字符串
+};
+
+// 定长日志记录, 节名存放在字符串池中, 原文和参数存放在所属缓冲区的参数区中
+// 原文与参数一起计入内存用量, 溢出时一起写入临时文件
+struct LogRecord {
+	uint64_t fingerprint{ };	// 基线指纹
+	uint64_t group{ };			// 聚合分组, 0代表未聚合
+	int32_t line{ };
+	uint32_t fileIndex{ };
+	uint32_t section{ };		// 节名在字符串池中的编号
+	uint32_t offset{ };			// 原文在参数区中的偏移, 参数紧接在原文之后
+	uint32_t originSize{ };		// 原文的字节数
+	uint32_t argSize{ };		// 参数的字节数
+	LogRule rule{ };
+	uint8_t severity{ };
+	bool isSectionName{ };
+
+	// payload为参数区中属于该记录的部分, 即原文 + 参数
+	size_t payloadSize() const { return static_cast<size_t>(originSize) + argSize; }
+	std::string_view origin(std::string_view payload) const { return payload.substr(0, originSize); }
+	std::string_view args(std::string_view payload) const { return payload.substr(originSize); }
+
+	// 与LogData一致, 按(文件, 行号)排序, 同一行再按规则、级别、原文、参数和节名排序
+	// 顺序只取决于日志内容, 与各线程产生日志的先后无关
+	static bool less(const LogRecord& l, std::string_view lPayload, const LogRecord& r, std::string_view rPayload);
+
+	static void encodeArgs(std::string& arena, const std::vector<LogArg>& args);
+	static std::vector<LogArg> decodeArgs(std::string_view bytes);
+};
+
+// 单个线程的日志缓冲区, 由定长记录和参数区组成
+// 占用内存超过上限时, 排序后整体写入临时文件, 输出时再与其余记录归并
+// 只有所属线程写入, 但溢出可能由其他线程执行, 因此两者都要持有mutex, 平时没有竞争
+class LogBuffer {
+public:
+	~LogBuffer();
+
+	size_t append(LogRecord record, std::string_view origin, const std::vector<LogArg>& args);
+	size_t bytes() const { return records.size() * sizeof(LogRecord) + arena.size(); }
+	std::string_view payload(const LogRecord& record) const { return std::string_view(arena).substr(record.offset, record.payloadSize()); }
+	void sort();
+	void spill();
+	void clear();
+
+	static std::filesystem::path tempPath();	// 本进程的临时文件路径, 每次调用都不同
+	static void mergeRuns(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output);
+
+	// 归并时同时打开的临时文件数上限, 远低于C运行库默认的512个FILE
+	static constexpr size_t MaxFanIn = 64;
+
+	std::mutex mutex;
+	std::vector<LogRecord> records;
+	std::string arena;
+	std::vector<std::filesystem::path> runs;	// 已写入临时文件的有序记录段
+};
+
+// 按顺序读取一个有序记录段, 来源可以是内存中的缓冲区或临时文件
+class LogCursor {
+public:
+	explicit LogCursor(const LogBuffer& buffer);
+	explicit LogCursor(const std::filesystem::path& run);
+
+	bool next();
+	const LogRecord& record() const { return current; }
+	std::string_view payload() const { return currentPayload; }
+
+private:
+	const LogBuffer* buffer{ nullptr };
+	size_t index{ };
+	std::filesystem::path path;
+	std::ifstream file;
+	std::string filePayload;
+	LogRecord current;
+	std::string_view currentPayload;
+};
+
+// 按LogRecord::less归并多个有序记录段, 依次对最小的记录调用func(cursor)
+// 游标在第一次next之后不能再移动, 因此cursors在归并期间不能增删
+template<typename Func>
+void mergeCursors(std::vector<LogCursor>& cursors, Func&& func) {
+	auto greater = [&cursors](size_t l, size_t r) {
+		return LogRecord::less(cursors[r].record(), cursors[r].payload(), cursors[l].record(), cursors[l].payload());
+	};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+	for (size_t i = 0; i < cursors.size(); ++i)
+		if (cursors[i].next())
+			heap.push(i);
+
+	while (!heap.empty()) {
+		auto i = heap.top();
+		heap.pop();
+		func(cursors[i]);
+		if (cursors[i].next())
+			heap.push(i);
+	}
+}
@@ -0,0 +1,85 @@
+﻿#include "LogTemplate.h"
+#include <charconv>
+
+// 解析format字符串, 支持{}、{n}以及{n:spec}三种参数写法
+LogTemplate::LogTemplate(const std::string& format) {
+	size_t autoIndex = 0;
+	std::string literal;
+
+	auto flush = [&]() {
+		if (!literal.empty())
+			segments.push_back({ std::move(literal) });
+		literal.clear();
+	};
+
+	for (size_t i = 0; i < format.size(); ++i) {
+		char c = format[i];
+		if (c == '}') {
+			if (i + 1 >= format.size() || format[i + 1] != '}')
+				throw std::format_error("未匹配的'}'");
+			literal += '}';
+			++i;
+			continue;
+		}
+		if (c != '{') {
+			literal += c;
+			continue;
+		}
+		if (i + 1 < format.size() && format[i + 1] == '{') {
+			literal += '{';
+			++i;
+			continue;
+		}
+
+		size_t end = format.find('}', i);
+		if (end == std::string::npos)
+			throw std::format_error("未闭合的'{'");
+
+		auto field = format.substr(i + 1, end - i - 1);
+		auto colon = field.find(':');
+		auto id = field.substr(0, colon);
+
+		Segment segment;
+		if (id.empty())
+			segment.index = autoIndex++;
+		else {
+			auto [ptr, ec] = std::from_chars(id.data(), id.data() + id.size(), segment.index);
+			if (ec != std::errc() || ptr != id.data() + id.size())
+				throw std::format_error("无效的参数编号: " + id);
+		}
+		if (colon != std::string::npos)
+			segment.spec = "{:" + field.substr(colon + 1) + "}";
+
+		flush();
+		segments.push_back(std::move(segment));
+		i = end;
+	}
+	flush();
+}
+
+// 按片段拼接日志内容, 无格式说明的参数直接追加, 不经过std::format
+std::string LogTemplate::render(const std::vector<LogArg>& args) const {
+	std::string result;
+	for (const auto& segment : segments) {
+		if (segment.index == std::string::npos) {
+			result += segment.literal;
+			continue;
+		}
+		if (segment.index >= args.size())
+			throw std::format_error("参数数量不足");
+
+		std::visit([&](const auto& value) {
+			using T = std::decay_t<decltype(value)>;
+			if (!segment.spec.empty())
+				result += std::vformat(segment.spec, std::make_format_args(value));
+			else if constexpr (std::is_same_v<T, std::string>)
+				result += value;
+			else {
+				char buffer[32];
+				auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+				result.append(buffer, ptr);
+			}
+		}, args[segment.index]);
+	}
+	return result;
+}
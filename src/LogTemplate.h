@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <format>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+// 日志参数, 产生日志时只保存参数, 输出时才格式化
+using LogArg = std::variant<long long, unsigned long long, float, double, std::string>;
+
+// 预编译的日志模板
+// 启动时将[LogSetting]中的format字符串拆分为字面量片段和参数片段, 输出时按片段直接拼接
+class LogTemplate {
+public:
+	explicit LogTemplate() = default;
+	LogTemplate(const std::string& format);
+
+	std::string render(const std::vector<LogArg>& args) const;
+
+	template<typename T>
+	static LogArg makeArg(const T& value) {
+		using U = std::decay_t<T>;
+		if constexpr (std::is_same_v<U, bool>)
+			return std::string(value ? "true" : "false");
+		else if constexpr (std::is_same_v<U, char>)
+			return std::string(1, value);
+		else if constexpr (std::is_same_v<U, float>)
+			return value;
+		else if constexpr (std::is_floating_point_v<U>)
+			return static_cast<double>(value);
+		else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+			return static_cast<long long>(value);
+		else if constexpr (std::is_integral_v<U>)
+			return static_cast<unsigned long long>(value);
+		else if constexpr (std::is_convertible_v<const U&, std::string>)
+			return std::string(value);
+		else
+			return std::format("{}", value);
+	}
+
+private:
+	struct Segment {
+		std::string literal{ };				// 字面量, 已处理{{和}}的转义
+		size_t index{ std::string::npos };	// 参数编号, 为npos时代表字面量片段
+		std::string spec{ };				// 带格式说明时的完整format字符串, 如"{:<10}"
+	};
+
+	std::vector<Segment> segments;
+};
@@ -0,0 +1,182 @@
+﻿#include "LogWriter.h"
+#include "Log.h"
+
+LogWriter::LogWriter(std::ostream& stream, LogFormat format) : buffer(stream), format(format) {}
+
+const char* LogWriter::GetFileName(LogFormat format) {
+	switch (format) {
+	case LogFormat::Text:      return "Checker.log";
+	case LogFormat::Json:      return "Checker.json";
+	case LogFormat::JsonLines: return "Checker.jsonl";
+	case LogFormat::Sarif:     return "Checker.sarif";
+	default: __assume(0);
+	}
+}
+
+static const char* getSarifLevel(Severity severity) {
+	switch (severity) {
+	case Severity::DEFAULT: return "none";
+	case Severity::INFO:    return "note";
+	case Severity::WARNING: return "warning";
+	case Severity::ERROR:   return "error";
+	default: __assume(0);
+	}
+}
+
+void LogWriter::begin() {
+	first = true;
+	switch (format) {
+	case LogFormat::Json:
+		buffer << '[';
+		break;
+	case LogFormat::Sarif:
+		// 规则表在开头一次性写出, 结果中通过ruleIndex引用
+		buffer << "{\n"
+			<< "\t\"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n"
+			<< "\t\"version\": \"2.1.0\",\n"
+			<< "\t\"runs\": [{\n"
+			<< "\t\t\"tool\": {\"driver\": {\"name\": \"INIValidator\", "
+			<< "\"informationUri\": \"https://github.com/Super-StarX/INIValidator\", \"rules\": [";
+		for (size_t i = 0; i < std::size(LogRuleNames); ++i) {
+			buffer << (i ? ", " : "") << "{\"id\": ";
+			buffer.json(LogRuleNames[i]) << '}';
+		}
+		buffer << "]}},\n"
+			<< "\t\t\"results\": [";
+		break;
+	default:
+		break;
+	}
+}
+
+void LogWriter::write(const LogStream& log) {
+	switch (format) {
+	case LogFormat::Text:
+		log.appendFileMessage(buffer.str());
+		buffer << '\n';
+		break;
+	case LogFormat::Json:
+		writeJson(log);
+		break;
+	case LogFormat::JsonLines:
+		writeJsonLines(log);
+		break;
+	case LogFormat::Sarif:
+		writeSarif(log);
+		break;
+	}
+	first = false;
+	buffer.commit();
+}
+
+void LogWriter::end() {
+	switch (format) {
+	case LogFormat::Json:
+		buffer << (first ? "" : "\n") << "]\n";
+		break;
+	case LogFormat::Sarif:
+		buffer << (first ? "" : "\n\t\t") << "]\n"
+			<< "\t}]\n"
+			<< "}\n";
+		break;
+	default:
+		break;
+	}
+	buffer.flush();
+}
+
+void LogWriter::writeJson(const LogStream& log) {
+	buffer << (first ? "\n" : ",\n")
+		<< "\t{\n"
+		<< "\t\t\"filename\": ";
+	buffer.json(IniFile::GetFileName(log.data.fileindex)) << ",\n"
+		<< "\t\t\"line\": " << log.data.line << ",\n"
+		<< "\t\t\"section\": ";
+	buffer.json(log.data.section) << ",\n"
+		<< "\t\t\"level\": ";
+	buffer.json(Log::getJsonSeverityLabel(log.severity)) << ",\n"
+		<< "\t\t\"message\": ";
+	buffer.json(log.buffer);
+	if (log.group) {
+		buffer << ",\n"
+			<< "\t\t\"count\": " << log.group->count << ",\n"
+			<< "\t\t\"locations\": ";
+		writeLocations(log);
+	}
+	buffer << "\n"
+		<< "\t}";
+}
+
+void LogWriter::writeJsonLines(const LogStream& log) {
+	buffer << "{\"filename\": ";
+	buffer.json(IniFile::GetFileName(log.data.fileindex))
+		<< ", \"line\": " << log.data.line
+		<< ", \"section\": ";
+	buffer.json(log.data.section) << ", \"rule\": ";
+	buffer.json(LogRuleNames[static_cast<size_t>(log.rule)]) << ", \"level\": ";
+	buffer.json(Log::getJsonSeverityLabel(log.severity)) << ", \"message\": ";
+	buffer.json(log.buffer);
+	if (log.group) {
+		buffer << ", \"count\": " << log.group->count << ", \"locations\": ";
+		writeLocations(log);
+	}
+	buffer << "}\n";
+}
+
+void LogWriter::writeSarif(const LogStream& log) {
+	auto rule = static_cast<size_t>(log.rule);
+	buffer << (first ? "\n" : ",\n")
+		<< "\t\t\t{\"ruleId\": ";
+	buffer.json(LogRuleNames[rule]) << ", \"ruleIndex\": " << rule
+		<< ", \"level\": \"" << getSarifLevel(log.severity) << "\""
+		<< ", \"message\": {\"text\": ";
+	buffer.json(log.buffer) << "}"
+		<< ", \"locations\": [{\"physicalLocation\": {\"artifactLocation\": {\"uri\": ";
+	buffer.json(IniFile::GetFileName(log.data.fileindex)) << '}';
+	// SARIF的行号从1开始, 没有行号的日志不写region
+	if (log.data.line > 0)
+		buffer << ", \"region\": {\"startLine\": " << log.data.line << '}';
+	buffer << '}';
+	if (!log.data.section.empty()) {
+		buffer << ", \"logicalLocations\": [{\"name\": ";
+		buffer.json(log.data.section) << ", \"kind\": \"object\"}]";
+	}
+	buffer << "}]";
+	// 聚合后的日志: 出现次数写入occurrenceCount, 其余位置写入relatedLocations
+	if (log.group) {
+		buffer << ", \"occurrenceCount\": " << log.group->count;
+		if (log.group->locations.size() > 1) {
+			buffer << ", \"relatedLocations\": [";
+			for (size_t i = 1; i < log.group->locations.size(); ++i) {
+				const auto& location = log.group->locations[i];
+				buffer << (i > 1 ? ", " : "") << "{\"id\": " << i
+					<< ", \"physicalLocation\": {\"artifactLocation\": {\"uri\": ";
+				buffer.json(IniFile::GetFileName(location.fileIndex)) << '}';
+				if (location.line > 0)
+					buffer << ", \"region\": {\"startLine\": " << location.line << '}';
+				buffer << '}';
+				if (auto& section = StringPool::get(location.section); !section.empty()) {
+					buffer << ", \"logicalLocations\": [{\"name\": ";
+					buffer.json(section) << ", \"kind\": \"object\"}]";
+				}
+				buffer << '}';
+			}
+			buffer << ']';
+		}
+	}
+	buffer << '}';
+}
+
+// 聚合后的日志列出的位置, JSON和JSON Lines共用
+void LogWriter::writeLocations(const LogStream& log) {
+	buffer << '[';
+	for (size_t i = 0; i < log.group->locations.size(); ++i) {
+		const auto& location = log.group->locations[i];
+		buffer << (i ? ", " : "") << "{\"filename\": ";
+		buffer.json(IniFile::GetFileName(location.fileIndex))
+			<< ", \"line\": " << location.line
+			<< ", \"section\": ";
+		buffer.json(StringPool::get(location.section)) << '}';
+	}
+	buffer << ']';
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include "OutputBuffer.h"
+#include "Settings.h"
+#include <ostream>
+
+// 日志文件写入器
+// 日志逐条格式化后追加到缓冲区并分块写出, 不在内存中构建完整的文档
+// Text:      与控制台相同的纯文本
+// Json:      一个包含所有日志的数组
+// JsonLines: 每行一个JSON对象, 便于CI逐行读取
+// Sarif:     SARIF 2.1.0, 可被代码扫描平台直接导入
+class LogStream;
+class LogWriter {
+public:
+	LogWriter(std::ostream& stream, LogFormat format);
+
+	static const char* GetFileName(LogFormat format);
+
+	void begin();
+	void write(const LogStream& log);
+	void end();
+
+private:
+	void writeJson(const LogStream& log);
+	void writeJsonLines(const LogStream& log);
+	void writeSarif(const LogStream& log);
+	void writeLocations(const LogStream& log);
+
+	OutputBuffer buffer;
+	LogFormat format;
+	bool first{ true };
+};
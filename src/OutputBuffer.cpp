@@ -0,0 +1,29 @@
+﻿#include "OutputBuffer.h"
+#include "Helper.h"
+
+OutputBuffer::OutputBuffer(std::ostream& stream, size_t capacity) : stream(stream), capacity(capacity) {
+	buffer.reserve(capacity + 4096);
+}
+
+OutputBuffer::~OutputBuffer() {
+	flush();
+}
+
+OutputBuffer& OutputBuffer::json(std::string_view str) {
+	buffer += '"';
+	string::appendEscapedJson(buffer, str);
+	buffer += '"';
+	return *this;
+}
+
+void OutputBuffer::commit() {
+	if (buffer.size() >= capacity)
+		flush();
+}
+
+void OutputBuffer::flush() {
+	if (buffer.empty())
+		return;
+	stream.write(buffer.data(), buffer.size());
+	buffer.clear();
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <charconv>
+#include <concepts>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// 可复用的输出缓冲区, 内容先追加到内存中, 超过容量后整块写入目标流
+class OutputBuffer {
+public:
+	explicit OutputBuffer(std::ostream& stream, size_t capacity = 1 << 20);
+	~OutputBuffer();
+
+	OutputBuffer(const OutputBuffer&) = delete;
+	OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+	OutputBuffer& operator<<(std::string_view str) { buffer += str; return *this; }
+	OutputBuffer& operator<<(char c) { buffer += c; return *this; }
+
+	template<std::integral T>
+	OutputBuffer& operator<<(T value) {
+		char temp[24];
+		auto [ptr, ec] = std::to_chars(temp, temp + sizeof(temp), value);
+		buffer.append(temp, ptr);
+		return *this;
+	}
+
+	// 写入带引号的JSON字符串
+	OutputBuffer& json(std::string_view str);
+
+	std::string& str() { return buffer; }	// 供直接向缓冲区追加内容的函数使用
+	void commit();							// 超过容量时写出
+	void flush();							// 无条件写出
+
+private:
+	std::ostream& stream;
+	std::string buffer;
+	size_t capacity;
+};
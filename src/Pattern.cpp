@@ -0,0 +1,378 @@
+﻿#include "Pattern.h"
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+
+namespace {
+	using CharSet = std::bitset<256>;
+
+	// 语法树, 解析后再展开为NFA, 这样{n,m}可以重复生成子树
+	struct Node {
+		enum class Kind { Empty, Set, Concat, Alt, Repeat };
+		Kind kind{ Kind::Empty };
+		int set{ -1 };
+		int min{ 0 };
+		int max{ 0 };	// -1为不限
+		std::vector<Node> children;
+	};
+
+	// 带ε边的NFA, 每个状态最多一条字符边
+	struct NfaState {
+		int set{ -1 };
+		int next{ -1 };
+		std::vector<int> epsilon;
+	};
+
+	class Parser {
+	public:
+		Parser(std::string_view pattern, bool caseSensitive, int maxRepeat)
+			:pattern(pattern), caseSensitive(caseSensitive), maxRepeat(maxRepeat) {}
+
+		Node parse() {
+			if (peek('^'))
+				++pos;
+			auto node = parseAlt();
+			if (pos < pattern.size())
+				fail("多余的)");
+			return node;
+		}
+
+		std::vector<CharSet> sets;
+
+	private:
+		[[noreturn]] void fail(const std::string& message) const {
+			throw std::invalid_argument("第" + std::to_string(pos + 1) + "个字符处" + message);
+		}
+		bool peek(char c) const { return pos < pattern.size() && pattern[pos] == c; }
+		bool atEnd() const { return pos >= pattern.size() || (pattern[pos] == '$' && pos + 1 == pattern.size()); }
+
+		Node parseAlt() {
+			Node alt{ Node::Kind::Alt };
+			alt.children.push_back(parseConcat());
+			while (peek('|')) {
+				++pos;
+				alt.children.push_back(parseConcat());
+			}
+			return alt.children.size() == 1 ? std::move(alt.children.front()) : alt;
+		}
+
+		Node parseConcat() {
+			Node concat{ Node::Kind::Concat };
+			while (!atEnd() && !peek('|') && !peek(')'))
+				concat.children.push_back(parseRepeat());
+			if (atEnd() && pos < pattern.size())
+				++pos; // 结尾的$
+			return concat;
+		}
+
+		Node parseRepeat() {
+			auto atom = parseAtom();
+			while (pos < pattern.size()) {
+				int min, max;
+				char c = pattern[pos];
+				if (c == '*') min = 0, max = -1;
+				else if (c == '+') min = 1, max = -1;
+				else if (c == '?') min = 0, max = 1;
+				else if (c == '{') parseBraces(min, max);
+				else break;
+				if (c != '{')
+					++pos;
+
+				Node repeat{ Node::Kind::Repeat };
+				repeat.min = min;
+				repeat.max = max;
+				repeat.children.push_back(std::move(atom));
+				atom = std::move(repeat);
+			}
+			return atom;
+		}
+
+		// {n} {n,} {n,m}
+		void parseBraces(int& min, int& max) {
+			++pos;
+			min = parseNumber();
+			max = min;
+			if (peek(',')) {
+				++pos;
+				max = peek('}') ? -1 : parseNumber();
+			}
+			if (!peek('}'))
+				fail("的重复次数缺少}");
+			++pos;
+			if (max != -1 && max < min)
+				fail("的重复次数上限小于下限");
+		}
+
+		int parseNumber() {
+			if (pos >= pattern.size() || !isdigit(static_cast<unsigned char>(pattern[pos])))
+				fail("的重复次数不是数字");
+			int value = 0;
+			while (pos < pattern.size() && isdigit(static_cast<unsigned char>(pattern[pos]))) {
+				value = value * 10 + (pattern[pos++] - '0');
+				if (value > maxRepeat)
+					fail("的重复次数超过" + std::to_string(maxRepeat));
+			}
+			return value;
+		}
+
+		Node parseAtom() {
+			char c = pattern[pos++];
+			switch (c) {
+			case '(': {
+				if (pattern.substr(pos, 2) == "?:")
+					pos += 2;
+				auto node = parseAlt();
+				if (!peek(')'))
+					fail("缺少)");
+				++pos;
+				return node;
+			}
+			case '[':
+				return makeSet(parseClass());
+			case '.':
+				return makeSet(CharSet().set());
+			case '\\':
+				return makeSet(parseEscape());
+			case '*': case '+': case '?': case '{':
+				--pos;
+				fail("的量词前没有内容");
+			default:
+				return makeSet(fold(CharSet().set(static_cast<unsigned char>(c))));
+			}
+		}
+
+		// [abc] [^a-z] [\d_]
+		CharSet parseClass() {
+			CharSet set;
+			bool negate = peek('^');
+			if (negate)
+				++pos;
+			bool first = true;
+			while (pos < pattern.size() && (first || pattern[pos] != ']')) {
+				first = false;
+				if (pattern[pos] == '\\') {
+					++pos;
+					auto escaped = parseEscape();
+					set |= escaped;
+					continue;
+				}
+				auto low = static_cast<unsigned char>(pattern[pos++]);
+				if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+					++pos;
+					unsigned char high;
+					if (pattern[pos] == '\\') {
+						++pos;
+						auto escaped = parseEscape();
+						if (escaped.count() != 1)
+							fail("的范围终点不是单个字符");
+						high = 0;
+						while (!escaped.test(high)) ++high;
+					}
+					else
+						high = static_cast<unsigned char>(pattern[pos++]);
+					if (high < low)
+						fail("的字符范围顺序颠倒");
+					for (int i = low; i <= high; ++i)
+						set.set(i);
+				}
+				else
+					set.set(low);
+			}
+			if (!peek(']'))
+				fail("缺少]");
+			++pos;
+			set = fold(set);
+			return negate ? ~set : set;
+		}
+
+		CharSet parseEscape() {
+			if (pos >= pattern.size())
+				fail("的转义不完整");
+			char c = pattern[pos++];
+			CharSet set;
+			switch (c) {
+			case 'd': case 'D':
+				for (int i = '0'; i <= '9'; ++i) set.set(i);
+				break;
+			case 'w': case 'W':
+				for (int i = 0; i < 256; ++i)
+					if (isalnum(i) || i == '_') set.set(i);
+				break;
+			case 's': case 'S':
+				for (char space : std::string_view(" \t\r\n\f\v")) set.set(static_cast<unsigned char>(space));
+				break;
+			case 't': return CharSet().set('\t');
+			case 'n': return CharSet().set('\n');
+			case 'r': return CharSet().set('\r');
+			default:
+				if (isalnum(static_cast<unsigned char>(c))) {
+					--pos;
+					fail("的转义\\" + std::string(1, c) + "不受支持");
+				}
+				return CharSet().set(static_cast<unsigned char>(c));
+			}
+			set = fold(set);
+			return isupper(static_cast<unsigned char>(c)) ? ~set : set;
+		}
+
+		// 忽略大小写时补上另一种大小写, 必须在取反之前进行, 否则[^a-z]取反后再补会包含所有字母
+		CharSet fold(CharSet set) const {
+			if (!caseSensitive)
+				for (int i = 'a'; i <= 'z'; ++i)
+					if (set.test(i) || set.test(i - 'a' + 'A')) {
+						set.set(i);
+						set.set(i - 'a' + 'A');
+					}
+			return set;
+		}
+
+		// 字符集去重后保存
+		Node makeSet(const CharSet& set) {
+			Node node{ Node::Kind::Set };
+			auto it = std::find(sets.begin(), sets.end(), set);
+			node.set = static_cast<int>(it - sets.begin());
+			if (it == sets.end())
+				sets.push_back(set);
+			return node;
+		}
+
+		std::string_view pattern;
+		size_t pos{ 0 };
+		bool caseSensitive;
+		int maxRepeat;
+	};
+
+	// Thompson构造, 从后往前生成, 返回进入node的状态, 匹配完node后转到next
+	class NfaBuilder {
+	public:
+		std::vector<NfaState> states;
+
+		int add() {
+			states.emplace_back();
+			if (states.size() > 100000)
+				throw std::invalid_argument("展开后的状态过多, 请减少{n,m}的重复次数");
+			return static_cast<int>(states.size() - 1);
+		}
+
+		int build(const Node& node, int next) {
+			switch (node.kind) {
+			case Node::Kind::Set: {
+				int state = add();
+				states[state].set = node.set;
+				states[state].next = next;
+				return state;
+			}
+			case Node::Kind::Concat:
+				for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+					next = build(*it, next);
+				return next;
+			case Node::Kind::Alt: {
+				int state = add();
+				for (const auto& child : node.children) {
+					int entry = build(child, next);
+					states[state].epsilon.push_back(entry);
+				}
+				return state;
+			}
+			case Node::Kind::Repeat: {
+				const auto& child = node.children.front();
+				int entry = next;
+				if (node.max == -1) {
+					int loop = add();
+					int body = build(child, loop);
+					states[loop].epsilon = { body, next };
+					entry = loop;
+				}
+				else
+					for (int i = node.min; i < node.max; ++i) {
+						int optional = add();
+						int body = build(child, entry);
+						states[optional].epsilon = { body, next };
+						entry = optional;
+					}
+				for (int i = 0; i < node.min; ++i)
+					entry = build(child, entry);
+				return entry;
+			}
+			default:
+				return next;
+			}
+		}
+
+		// ε闭包, 只保留有字符边的状态和终态, 排序后作为DFA状态的键
+		std::vector<int> closure(std::vector<int> pending, int accept) const {
+			std::vector<uint8_t> visited(states.size());
+			std::vector<int> result;
+			while (!pending.empty()) {
+				int state = pending.back();
+				pending.pop_back();
+				if (visited[state])
+					continue;
+				visited[state] = 1;
+				if (states[state].set != -1 || state == accept)
+					result.push_back(state);
+				pending.insert(pending.end(), states[state].epsilon.begin(), states[state].epsilon.end());
+			}
+			std::sort(result.begin(), result.end());
+			return result;
+		}
+	};
+}
+
+Pattern::Pattern(std::string_view pattern, bool caseSensitive) :text(pattern) {
+	Parser parser(pattern, caseSensitive, MaxRepeat);
+	auto root = parser.parse();
+
+	NfaBuilder nfa;
+	int accept = nfa.add();
+	int entry = nfa.build(root, accept);
+
+	// 按各字符集的成员关系划分字节等价类, 同一类的字节转移完全相同
+	std::map<std::vector<bool>, uint8_t> signatures;
+	std::vector<unsigned char> representatives;
+	for (int c = 0; c < 256; ++c) {
+		std::vector<bool> signature(parser.sets.size());
+		for (size_t i = 0; i < parser.sets.size(); ++i)
+			signature[i] = parser.sets[i].test(c);
+		auto [it, inserted] = signatures.try_emplace(std::move(signature), static_cast<uint8_t>(representatives.size()));
+		if (inserted)
+			representatives.push_back(static_cast<unsigned char>(c));
+		classes[c] = it->second;
+	}
+	classCount = representatives.size();
+
+	// 子集构造, 0号为死状态
+	std::map<std::vector<int>, uint16_t> ids;
+	std::vector<std::vector<int>> subsets{ {} };
+	transitions.assign(classCount, Dead);
+	accepting.assign(1, 0);
+	auto intern = [&](std::vector<int> subset) -> uint16_t {
+		if (subset.empty())
+			return Dead;
+		auto [it, inserted] = ids.try_emplace(std::move(subset), static_cast<uint16_t>(subsets.size()));
+		if (inserted) {
+			if (subsets.size() >= MaxStates)
+				throw std::invalid_argument("编译后的状态超过" + std::to_string(MaxStates) + "个, 请简化表达式");
+			subsets.push_back(it->first);
+			transitions.resize(transitions.size() + classCount, Dead);
+			accepting.push_back(std::binary_search(it->first.begin(), it->first.end(), accept));
+		}
+		return it->second;
+	};
+
+	intern(nfa.closure({ entry }, accept)); // 入口的闭包至少含有终态或一条字符边, 必定得到Start
+	for (size_t state = Start; state < subsets.size(); ++state) {
+		for (size_t cls = 0; cls < classCount; ++cls) {
+			std::vector<int> moved;
+			for (int nfaState : subsets[state]) {
+				const auto& s = nfa.states[nfaState];
+				if (s.set != -1 && parser.sets[s.set].test(representatives[cls]))
+					moved.push_back(s.next);
+			}
+			auto target = intern(nfa.closure(std::move(moved), accept));
+			transitions[state * classCount + cls] = target;
+		}
+	}
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 正则表达式的子集, 加载时编译为DFA, 匹配时每个字节查一次表, 不回溯, 耗时与值的长度成正比, 也不分配内存
+// 支持: 字面量、.、[abc]/[^a-z]字符集、\d \w \s \D \W \S及符号转义、(...)/(?:...)分组、|、* + ? {n} {n,} {n,m}
+// 总是匹配整个值, 开头的^和结尾的$可写可不写; 按字节匹配, 中文等多字节字符可以作为字面量, 但.只匹配一个字节
+class Pattern {
+public:
+	Pattern() = default;
+	// 语法错误或编译出的状态过多时抛出std::invalid_argument
+	Pattern(std::string_view pattern, bool caseSensitive = true);
+
+	bool match(std::string_view value) const {
+		uint16_t state = Start;
+		for (unsigned char c : value) {
+			state = transitions[state * classCount + classes[c]];
+			if (state == Dead)
+				return false;
+		}
+		return accepting[state];
+	}
+	bool empty() const { return accepting.empty(); }
+	const std::string& source() const { return text; }
+
+private:
+	static constexpr uint16_t Dead = 0;			// 无法再匹配的状态, 转移表中全部指向自身
+	static constexpr uint16_t Start = 1;
+	static constexpr size_t MaxStates = 4096;	// DFA状态数上限, 超过时视为配置错误
+	static constexpr int MaxRepeat = 1000;		// {n,m}中的上限
+
+	std::string text;
+	std::array<uint8_t, 256> classes{};			// 字节 <-> 等价类, 所有字符集都无法区分的字节归为一类
+	size_t classCount{ 1 };
+	std::vector<uint16_t> transitions;			// 状态 * classCount + 等价类 <-> 下一状态
+	std::vector<uint8_t> accepting;				// 状态 <-> 是否匹配成功
+};
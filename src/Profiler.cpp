@@ -0,0 +1,207 @@
+﻿#include "Profiler.h"
+#include "Helper.h"
+#include "OutputBuffer.h"
+#include "Trace.h"
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+bool Profiler::Enabled = false;
+bool Profiler::Active = false;
+std::vector<std::unique_ptr<Profiler::ThreadStats>> Profiler::Threads;
+std::mutex Profiler::threadMutex;
+
+static const char* getCategoryLabel(Profiler::Category category) {
+	switch (category) {
+	case Profiler::Category::Phase:   return "阶段";
+	case Profiler::Category::Checker: return "检查器";
+	case Profiler::Category::Type:    return "类型";
+	case Profiler::Category::Script:  return "脚本";
+	case Profiler::Category::Registry: return "注册表";
+	default: __assume(0);
+	}
+}
+
+const char* Profiler::GetCategoryName(Category category) {
+	switch (category) {
+	case Profiler::Category::Phase:   return "phase";
+	case Profiler::Category::Checker: return "checker";
+	case Profiler::Category::Type:    return "type";
+	case Profiler::Category::Script:  return "script";
+	case Profiler::Category::Registry: return "registry";
+	default: __assume(0);
+	}
+}
+
+void Profiler::init(bool enabled, bool tracing) {
+	Enabled = enabled;
+	Active = enabled || tracing;
+}
+
+void Profiler::Scope::begin(Category category, std::string_view name, std::string_view detail) {
+	this->active = true;
+	this->category = category;
+	this->name = name;
+	this->detail = detail;
+	if (Enabled)
+		this->cpuStart = threadCpuTime();
+	this->wallStart = std::chrono::steady_clock::now();
+}
+
+void Profiler::Scope::end() {
+	auto wallEnd = std::chrono::steady_clock::now();
+	active = false;
+	if (Trace::Enabled)
+		Trace::record(category, name, detail, wallStart, wallEnd);
+	if (!Enabled)
+		return;
+
+	auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - wallStart).count();
+	auto cpu = threadCpuTime() - cpuStart;
+
+	auto& map = localStats()[static_cast<size_t>(category)];
+	auto it = map.find(name);
+	if (it == map.end())
+		it = map.emplace(std::string(name), Stats()).first;
+	it->second.add(static_cast<uint64_t>(wall), cpu);
+}
+
+// 当前线程消耗的CPU时间(纳秒)
+// Windows下精度取决于时钟中断间隔(通常为15.6ms), 单次调用的CPU时间只在累计后有参考价值
+uint64_t Profiler::threadCpuTime() {
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+	auto toInt = [](const FILETIME& time) {
+		return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	};
+	return (toInt(kernel) + toInt(user)) * 100;
+#else
+	timespec time{ };
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+#endif
+}
+
+// 获取当前线程的统计表, 首次调用时登记到Threads中
+Profiler::ThreadStats& Profiler::localStats() {
+	thread_local ThreadStats* stats = nullptr;
+	if (!stats) {
+		std::lock_guard<std::mutex> lock(threadMutex);
+		stats = Threads.emplace_back(std::make_unique<ThreadStats>()).get();
+	}
+	return *stats;
+}
+
+size_t Profiler::bucketIndex(uint64_t value) {
+	if (value < SubBuckets)
+		return static_cast<size_t>(value);
+	size_t exponent = std::bit_width(value) - 1;	// >= 3
+	size_t sub = static_cast<size_t>(value >> (exponent - 3)) & (SubBuckets - 1);
+	return (exponent - 2) * SubBuckets + sub;
+}
+
+// 桶的下界, 取百分位时使用相邻两个桶下界的中点
+uint64_t Profiler::bucketValue(size_t index) {
+	if (index < SubBuckets)
+		return index;
+	size_t exponent = index / SubBuckets + 2;
+	size_t sub = index % SubBuckets;
+	return (SubBuckets + sub) << (exponent - 3);
+}
+
+void Profiler::Stats::add(uint64_t wall, uint64_t cpu) {
+	++count;
+	this->wall += wall;
+	this->cpu += cpu;
+	max = (std::max)(max, wall);
+	++buckets[bucketIndex(wall)];
+}
+
+void Profiler::Stats::merge(const Stats& other) {
+	count += other.count;
+	wall += other.wall;
+	cpu += other.cpu;
+	max = (std::max)(max, other.max);
+	for (size_t i = 0; i < BucketCount; ++i)
+		buckets[i] += other.buckets[i];
+}
+
+uint64_t Profiler::Stats::percentile(double ratio) const {
+	uint64_t target = static_cast<uint64_t>(ratio * count);
+	uint64_t sum = 0;
+	for (size_t i = 0; i < BucketCount; ++i) {
+		sum += buckets[i];
+		if (sum > target)
+			return (std::min)(i + 1 < BucketCount ? (bucketValue(i) + bucketValue(i + 1)) / 2 : bucketValue(i), max);
+	}
+	return max;
+}
+
+// 合并各线程的统计, 按总耗时从高到低输出表格和Profile.json
+void Profiler::report() {
+	if (!Enabled)
+		return;
+
+	struct Row {
+		Category category;
+		std::string name;
+		Stats stats;
+	};
+	std::vector<Row> rows;
+	{
+		std::lock_guard<std::mutex> lock(threadMutex);
+		std::array<StatsMap, static_cast<size_t>(Category::Count)> merged;
+		for (auto& thread : Threads)
+			for (size_t i = 0; i < merged.size(); ++i) {
+				for (const auto& [name, stats] : (*thread)[i])
+					merged[i][name].merge(stats);
+				(*thread)[i].clear();
+			}
+		for (size_t i = 0; i < merged.size(); ++i)
+			for (auto& [name, stats] : merged[i])
+				rows.push_back({ static_cast<Category>(i), name, stats });
+	}
+	std::sort(rows.begin(), rows.end(), [](const Row& l, const Row& r) {
+		return l.category != r.category ? l.category < r.category : l.stats.wall > r.stats.wall;
+	});
+
+	auto ms = [](uint64_t ns) { return ns / 1e6; };
+	auto us = [](uint64_t ns) { return ns / 1e3; };
+
+	// 表头中的汉字占两列, 宽度相应减少
+	std::cerr << std::format("\n{}{}{:>8}{:>9}{:>12}{:>12}{:>12}\n",
+		string::clamp("类别", 8), string::clamp("名称", 32), "次数", "总耗时ms", "CPUms", "p50us", "p99us");
+	for (const auto& [category, name, stats] : rows)
+		std::cerr << std::format("{}{}{:>10}{:>12.2f}{:>12.2f}{:>12.1f}{:>12.1f}\n",
+			string::clamp(getCategoryLabel(category), 8), string::clamp(name, 32), stats.count,
+			ms(stats.wall), ms(stats.cpu), us(stats.percentile(0.5)), us(stats.percentile(0.99)));
+
+	std::ofstream file("Profile.json", std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "无法写入Profile.json" << std::endl;
+		return;
+	}
+	OutputBuffer buffer(file);
+	buffer << '[';
+	for (size_t i = 0; i < rows.size(); ++i) {
+		const auto& [category, name, stats] = rows[i];
+		buffer << (i ? ",\n\t" : "\n\t") << "{\"category\": \"" << GetCategoryName(category) << "\", \"name\": ";
+		buffer.json(name) << ", \"count\": " << stats.count
+			<< ", \"wall_ns\": " << stats.wall
+			<< ", \"cpu_ns\": " << stats.cpu
+			<< ", \"p50_ns\": " << stats.percentile(0.5)
+			<< ", \"p99_ns\": " << stats.percentile(0.99)
+			<< ", \"max_ns\": " << stats.max << '}';
+	}
+	buffer << (rows.empty() ? "]\n" : "\n]\n");
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 性能分析, 命令行加上--profile启用
+// 按阶段、检查器、类型和脚本统计调用次数、墙钟时间、CPU时间和延迟分布, 检查结束后输出表格和Profile.json
+// 未启用时每个统计点只有一次判断; 启用时每个线程记录到自己的统计表, 输出时再合并
+// 统计点同时也是--trace的事件来源, 见Trace.h
+class Profiler {
+public:
+	enum class Category : uint8_t {
+		Phase,		// 加载、include、继承、各检查阶段、输出
+		Checker,	// 各类检查器
+		Type,		// 配置中的类型(节)
+		Script,		// Python脚本
+		Registry,	// 注册表
+		Count,
+	};
+
+	// 统计点, 从构造到析构(或next)之间的时间记入name, 时间包含嵌套的统计点
+	// detail只出现在跟踪事件中, 例如加载的文件路径
+	class Scope {
+	public:
+		Scope(Category category, std::string_view name, std::string_view detail = { }) {
+			if (Active) [[unlikely]]
+				begin(category, name, detail);
+		}
+		~Scope() {
+			if (active) [[unlikely]]
+				end();
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		// 结束当前统计并以新的名字重新开始, 用于依次执行的阶段
+		void next(std::string_view name) {
+			if (active) [[unlikely]] {
+				end();
+				begin(category, name, { });
+			}
+		}
+
+	private:
+		void begin(Category category, std::string_view name, std::string_view detail);
+		void end();
+
+		bool active{ false };
+		Category category{ };
+		std::string_view name;
+		std::string_view detail;
+		std::chrono::steady_clock::time_point wallStart;
+		uint64_t cpuStart{ };
+	};
+
+	static void init(bool enabled, bool tracing);
+	static const char* GetCategoryName(Category category);
+	static void report();	// 输出并清空本次检查的统计
+
+	static bool Enabled;	// --profile
+	static bool Active;		// 启用了--profile或--trace, 统计点只判断这一项
+
+private:
+	// 延迟分布: 以2的幂为一级, 每级再均分8份, 相对误差不超过12.5%
+	static constexpr size_t SubBuckets = 8;
+	static constexpr size_t BucketCount = (64 - 2) * SubBuckets;
+
+	struct Stats {
+		uint64_t count{ };
+		uint64_t wall{ };		// 纳秒
+		uint64_t cpu{ };		// 纳秒
+		uint64_t max{ };
+		std::array<uint32_t, BucketCount> buckets{ };
+
+		void add(uint64_t wall, uint64_t cpu);
+		void merge(const Stats& other);
+		uint64_t percentile(double ratio) const;
+	};
+
+	struct StringHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+	};
+	using StatsMap = std::unordered_map<std::string, Stats, StringHash, std::equal_to<>>;
+	using ThreadStats = std::array<StatsMap, static_cast<size_t>(Category::Count)>;
+
+	static size_t bucketIndex(uint64_t value);
+	static uint64_t bucketValue(size_t index);
+	static uint64_t threadCpuTime();
+	static ThreadStats& localStats();
+
+	static std::vector<std::unique_ptr<ThreadStats>> Threads;
+	static std::mutex threadMutex;
+};
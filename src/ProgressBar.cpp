@@ -1,13 +1,31 @@
 ﻿#include "ProgressBar.h"
 #include "Helper.h"
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#define _isatty isatty
+#define _fileno fileno
+#endif
 
 constexpr size_t fileNameWidth = 25; // 文件名宽度
 constexpr size_t totalLength = 50; // 进度条宽度
 
-Progress::Progress() {}
+thread_local int Progress::currentBar = -1;
+
+Progress::Progress() {
+	enabled = _isatty(_fileno(stderr)) != 0;
+}
 
 Progress::~Progress() {
-	stopDrawing();
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		quit = true;
+	}
+	cv.notify_all();
+	if (drawThread.joinable())
+		drawThread.join();
 }
 
 Progress& Progress::instance() {
@@ -27,63 +45,131 @@ void Progress::stop() {
 	instance()._stop();
 }
 
+// 为每个线程分配固定的计数槽
+size_t Progress::threadSlot() {
+	static std::atomic<size_t> nextSlot{ 0 };
+	thread_local size_t slot = nextSlot++ % MaxThreads;
+	return slot;
+}
+
 void Progress::_start(const std::string& name, size_t total) {
-	stop(); // 确保上一个进度条结束
+	if (!enabled)
+		return;
+	stop(); // 确保当前线程上一个进度条结束
 
 	std::lock_guard<std::mutex> lock(mtx);
-	this->startName = string::clamp(name, fileNameWidth);
-	this->total = total;
-	this->processed = 0;
-	this->startTime = std::chrono::steady_clock::now();
-	stopFlag = false;
-
-	// 启动渲染线程，每 25ms 刷新一次
-	drawThread = std::thread([this]() {
-		while (!stopFlag) {
-			draw();
-			std::this_thread::sleep_for(std::chrono::milliseconds(25));
-		}
-	});
+	size_t index = 0;
+	while (index < MaxBars && bars[index].active)
+		++index;
+	if (index == MaxBars)
+		return; // 同时显示的进度条过多, 不再显示新的
+
+	auto& bar = bars[index];
+	bar.name = string::clamp(name, fileNameWidth);
+	bar.total = total;
+	for (auto& counter : bar.processed)
+		counter.value.store(0, std::memory_order_relaxed);
+	bar.startTime = std::chrono::steady_clock::now();
+	bar.active = true;
+	bar.finished = false;
+	order.push_back(index);
+	currentBar = static_cast<int>(index);
+	latestBar = currentBar;
+
+	if (!drawThread.joinable())
+		drawThread = std::thread(&Progress::run, this);
+	cv.notify_all();
 }
 
 void Progress::_update() {
-	++processed;
+	int index = currentBar >= 0 ? currentBar : latestBar.load(std::memory_order_relaxed);
+	if (index < 0)
+		return;
+	bars[index].processed[threadSlot()].value.fetch_add(1, std::memory_order_relaxed);
 }
 
+// 结束时同步绘制最后一次, 返回后进度条已完整输出
 void Progress::_stop() {
-	if (!stopFlag) {
-		processed = total;
-		stopDrawing();
-		draw();
-		std::cerr << "\n"; // 结束时换行
-	}
+	if (currentBar < 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	int index = currentBar;
+	bars[index].finished = true;
+	latestBar.compare_exchange_strong(index, -1);
+	currentBar = -1;
+	draw();
 }
 
-void Progress::stopDrawing() {
-	if (drawThread.joinable()) {
-		stopFlag = true;
-		drawThread.join();
+// 没有进度条时休眠, 有进度条时每25ms刷新一次
+void Progress::run() {
+	std::unique_lock<std::mutex> lock(mtx);
+	while (!quit) {
+		if (order.empty())
+			cv.wait(lock);
+		else {
+			cv.wait_for(lock, std::chrono::milliseconds(25));
+			draw();
+		}
 	}
 }
 
+// 回到上次绘制的第一行重新绘制
+// 已结束的进度条绘制最后一次后固定在上方, 其余的在下方持续刷新
 void Progress::draw() {
-	double percent = getPercent();
-	auto elapsed = getElapsed();
+	if (order.empty())
+		return;
+
+	std::string out;
+	if (drawnLines > 1)
+		out += std::format("\033[{}A", drawnLines - 1);
+	out += '\r';
+
+	std::vector<int> running;
+	for (int index : order) {
+		auto& bar = bars[index];
+		if (bar.finished) {
+			out += "\033[2K" + drawBar(bar) + "\n"; // 结束时换行
+			bar.active = false;
+		}
+		else
+			running.push_back(index);
+	}
+	for (size_t i = 0; i < running.size(); ++i)
+		out += (i ? "\n\033[2K" : "\033[2K") + drawBar(bars[running[i]]);
+
+	order = std::move(running);
+	drawnLines = order.size();
+	std::cerr.write(out.data(), out.size());
+	std::cerr.flush();
+}
+
+std::string Progress::drawBar(const Bar& bar) {
+	double percent = bar.getPercent();
+	auto elapsed = bar.getElapsed();
+	size_t processed = bar.finished ? bar.total : bar.getProcessed();
 
 	// 渲染进度条
 	size_t completed = (size_t)(percent / 2);
 	size_t remain = totalLength - completed;
-	std::cerr << "\r" << startName << std::format("[\033[32m{0:━<{1}}>\033[90m{2:┈<{3}}\033[0m]", "", completed, "", remain);
+	return std::format("{0}[\033[32m{1:━<{2}}>\033[90m{3:┈<{4}}\033[0m]{5}/{6} ({7:.2f}% {8}ms)",
+		bar.name, "", completed, "", remain, processed, bar.total, percent, elapsed);
+}
 
-	// 显示百分比和时间
-	std::cerr << std::fixed << std::setprecision(2) << processed << "/" << total << " (" << percent << "% " << elapsed << "ms)";
+size_t Progress::Bar::getProcessed() const {
+	size_t sum = 0;
+	for (const auto& counter : processed)
+		sum += counter.value.load(std::memory_order_relaxed);
+	return sum;
 }
 
-double Progress::getPercent() const {
-	return total > 0 ? std::clamp((double)processed / total * 100, 0.0, 100.0) : 0.0;
+double Progress::Bar::getPercent() const {
+	if (finished)
+		return total > 0 ? 100.0 : 0.0;
+	return total > 0 ? std::clamp((double)getProcessed() / total * 100, 0.0, 100.0) : 0.0;
 }
 
-long long Progress::getElapsed() const {
+long long Progress::Bar::getElapsed() const {
 	auto now = std::chrono::steady_clock::now();
 	return std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
 }
@@ -97,4 +183,4 @@ void Progress::forEach(const std::string& name, const Container& container, Func
 		update();
 	}
 	stop();
-}
\ No newline at end of file
+}
@@ -1,16 +1,23 @@
 ﻿#pragma once
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 #include <iostream>
 
+// 进度条
+// 每个线程在自己独占的缓存行上计数, 由常驻的渲染线程汇总后绘制, update不产生线程间竞争
+// 多个线程同时start时(例如并行加载多个文件)显示为多行进度条
+// stderr不是终端时(例如CI日志)自动禁用, 所有调用只剩一次判断
 class Progress {
 public:
 	static Progress& instance();  // 单实例获取
 
+	// 作用于当前线程的进度条, 未start过的线程update时计入最近启动的进度条
 	static void start(const std::string& name, size_t total);
 	static void update();
 	static void stop();
@@ -21,6 +28,27 @@ public:
 	void forEach(const std::string& name, const Container& container, Func func);
 
 private:
+	static constexpr size_t MaxBars = 8;		// 同时显示的进度条数量上限
+	static constexpr size_t MaxThreads = 64;	// 计数槽数量, 超过时多个线程共用一个槽
+
+	// 独占一个缓存行的计数器, 避免多个线程的计数互相使缓存失效
+	struct alignas(64) Counter {
+		std::atomic<size_t> value{ 0 };
+	};
+
+	struct Bar {
+		std::string name;                // 进度条名称
+		size_t total{ 0 };               // 总项数
+		std::chrono::steady_clock::time_point startTime;
+		std::array<Counter, MaxThreads> processed; // 各线程已处理项
+		bool active{ false };            // 正在显示
+		bool finished{ false };          // 已结束, 等待最后一次绘制
+
+		size_t getProcessed() const;
+		double getPercent() const;
+		long long getElapsed() const;
+	};
+
 	Progress(); // 私有构造函数
 	Progress(const Progress&) = delete;
 	Progress& operator=(const Progress&) = delete;
@@ -28,17 +56,21 @@ private:
 	void _start(const std::string& name, size_t total);
 	void _update();
 	void _stop();
-	void draw();         // 渲染进度条
-	void stopDrawing();  // 停止刷新线程
-	double getPercent() const;
-	long long getElapsed() const;
+	void run();          // 渲染线程
+	void draw();         // 渲染进度条, 调用时需持有mtx
+	static std::string drawBar(const Bar& bar);
+
+	static size_t threadSlot();
+	static thread_local int currentBar;  // 当前线程启动的进度条, -1代表没有
 
-	std::string startName;           // 进度条名称
-	size_t total{ 0 };               // 总项数
-	std::atomic<size_t> processed{ 0 }; // 已处理项
-	std::chrono::steady_clock::time_point startTime;
+	bool enabled{ false };
+	std::array<Bar, MaxBars> bars;
+	std::vector<int> order;              // 正在显示的进度条, 按启动顺序排列
+	std::atomic<int> latestBar{ -1 };    // 最近启动的进度条
+	size_t drawnLines{ 0 };              // 上次绘制时占用的行数
 
 	std::mutex mtx;
-	std::atomic<bool> stopFlag{ true };
-	std::thread drawThread;  // 渲染线程
+	std::condition_variable cv;
+	bool quit{ false };
+	std::thread drawThread;  // 渲染线程, 首次start时启动, 程序结束时退出
 };
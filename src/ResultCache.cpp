@@ -0,0 +1,344 @@
+﻿#include "Checker.h"
+#include "Helper.h"
+#include "Profiler.h"
+#include "ResultCache.h"
+#include "Settings.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+size_t ResultCache::Hits = 0;
+size_t ResultCache::Changed = 0;
+std::atomic<size_t> ResultCache::MemoryUsage(0);
+bool ResultCache::Enabled = false;
+std::string ResultCache::Path;
+uint64_t ResultCache::Schema = 0;
+NameMap<uint64_t> ResultCache::Hashes;
+NameMap<uint64_t> ResultCache::PreviousHashes;
+NameMap<NameSet> ResultCache::Referrers;
+NameSet ResultCache::Dirty;
+std::unordered_map<uint64_t, ResultCache::Entry> ResultCache::Previous;
+std::unordered_map<uint64_t, ResultCache::Entry> ResultCache::Current;
+thread_local std::vector<ResultCache::Frame> ResultCache::Frames;
+
+using binary::write;
+using binary::writeString;
+
+namespace {
+	// 键值对的哈希相加得到节的哈希, 与遍历顺序无关; 相加前再混合一次, 避免相似的键值互相抵消
+	uint64_t mix(uint64_t hash) {
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+}
+
+void ResultCache::init(const std::string& path, const std::vector<std::string>& schemaFiles, bool watch) {
+	Enabled = watch || !path.empty();
+	if (!Enabled)
+		return;
+
+	// 配置、设置或日志规则改变都可能改变检查结果, 直接使整个缓存失效
+	Schema = hash::combine(hash::FnvOffset, std::to_string(Version));
+	for (const auto& file : schemaFiles) {
+		std::ifstream stream(file, std::ios::binary);
+		Schema = hash::combine(Schema, std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+	}
+	for (auto name : LogRuleNames)
+		Schema = hash::combine(Schema, name);
+
+	Path = path;
+	if (!Path.empty())
+		load();
+}
+
+void ResultCache::load() {
+	std::ifstream file(Path, std::ios::binary);
+	if (!file.is_open())
+		return;
+	std::string bytes(std::istreambuf_iterator<char>(file), {});
+
+	// 文件损坏时整个缓存作废
+	try {
+		binary::Reader reader(bytes);
+		if (reader.read<uint32_t>() != Version || reader.read<uint64_t>() != Schema)
+			return;
+
+		auto count = reader.read<uint64_t>();
+		for (uint64_t i = 0; i < count; ++i) {
+			auto name = reader.readString();
+			PreviousHashes[name] = reader.read<uint64_t>();
+		}
+
+		count = reader.read<uint64_t>();
+		for (uint64_t i = 0; i < count; ++i) {
+			auto key = reader.read<uint64_t>();
+			Entry entry;
+			entry.section = reader.readString();
+			entry.logs.resize(reader.readCount(sizeof(uint8_t) * 2 + sizeof(uint16_t) + sizeof(uint32_t) * 2));
+			for (auto& log : entry.logs) {
+				log.severity = reader.read<uint8_t>();
+				log.rule = static_cast<LogRule>(reader.read<uint16_t>());
+				log.isSectionName = reader.read<uint8_t>();
+				log.key = reader.readString();
+				log.args = reader.readString();
+				if (log.rule >= LogRule::Count)
+					throw std::out_of_range("缓存文件中的日志规则无效");
+			}
+			entry.references.resize(reader.readCount(sizeof(uint32_t) * 2));
+			for (auto& [name, type] : entry.references) {
+				name = reader.readString();
+				type = reader.readString();
+			}
+			entry.lookups.resize(reader.readCount(sizeof(uint32_t)));
+			for (auto& name : entry.lookups)
+				name = reader.readString();
+
+			for (const auto& name : entry.lookups)
+				Referrers[name].insert(entry.section);
+			Previous.emplace(key, std::move(entry));
+		}
+	}
+	catch (const std::exception& e) {
+		Log::out("缓存文件{}无效, 将重新检查所有节: {}", Path, e.what());
+		PreviousHashes.clear();
+		Referrers.clear();
+		Previous.clear();
+	}
+}
+
+// 先比较每个节的内容哈希, 再通过反向索引找到引用了改变的节的节
+// 只有这两类节需要重新检查, 其余的节直接回放上次的日志
+void ResultCache::begin(const IniFile::Sections& sections) {
+	Hits = 0;
+	Changed = 0;
+	if (!Enabled)
+		return;
+	Profiler::Scope profile(Profiler::Category::Phase, "比较上次检查结果");
+	// 同一进程中再次检查时, 上一次的结果就是最新的缓存
+	if (!Hashes.empty()) {
+		Previous = std::move(Current);
+		PreviousHashes = std::move(Hashes);
+		Current.clear();
+		Hashes.clear();
+	}
+
+	Dirty.clear();
+	auto markChanged = [&](const std::string& name) {
+		++Changed;
+		if (auto it = Referrers.find(name); it != Referrers.end())
+			Dirty.insert(it->second.begin(), it->second.end());
+	};
+	Hashes.reserve(sections.size());
+	for (const auto& [name, section] : sections) {
+		auto hash = Hashes[name] = hashSection(section);
+		auto it = PreviousHashes.find(name);
+		if (it == PreviousHashes.end() || it->second != hash)
+			markChanged(name);
+	}
+	for (const auto& [name, _] : PreviousHashes)
+		if (!Hashes.contains(name))
+			markChanged(name);
+
+	// 反向索引在本次检查中重新建立
+	Referrers.clear();
+
+	size_t usage = footprint(Hashes) + footprint(PreviousHashes);
+	for (const auto& [_, entry] : Previous)
+		usage += footprint(entry);
+	MemoryUsage = usage;
+}
+
+// 检查结束后上次的结果不再需要, 只保留本次的结果
+void ResultCache::save() {
+	if (!Enabled)
+		return;
+	Previous.clear();
+	PreviousHashes.clear();
+	size_t usage = footprint(Hashes);
+	for (const auto& [_, entry] : Current)
+		usage += footprint(entry);
+	MemoryUsage = usage;
+	if (Path.empty())
+		return;
+
+	std::string buffer;
+	write(buffer, Version);
+	write(buffer, Schema);
+	write(buffer, static_cast<uint64_t>(Hashes.size()));
+	for (const auto& [name, hash] : Hashes) {
+		writeString(buffer, name);
+		write(buffer, hash);
+	}
+
+	write(buffer, static_cast<uint64_t>(Current.size()));
+	for (const auto& [key, entry] : Current) {
+		write(buffer, key);
+		writeString(buffer, entry.section);
+		write(buffer, static_cast<uint32_t>(entry.logs.size()));
+		for (const auto& log : entry.logs) {
+			write(buffer, log.severity);
+			write(buffer, static_cast<uint16_t>(log.rule));
+			write(buffer, static_cast<uint8_t>(log.isSectionName));
+			writeString(buffer, log.key);
+			writeString(buffer, log.args);
+		}
+		write(buffer, static_cast<uint32_t>(entry.references.size()));
+		for (const auto& [name, type] : entry.references) {
+			writeString(buffer, name);
+			writeString(buffer, type);
+		}
+		write(buffer, static_cast<uint32_t>(entry.lookups.size()));
+		for (const auto& name : entry.lookups)
+			writeString(buffer, name);
+	}
+
+	std::ofstream file(Path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		Log::out("无法写入缓存文件: {}", Path);
+		return;
+	}
+	file.write(buffer.data(), buffer.size());
+}
+
+// 行号和注释不参与计算, 只改变格式不会使缓存失效
+uint64_t ResultCache::hashSection(const Section& section) {
+	uint64_t sum = 0;
+	for (const auto& [key, value] : section) {
+		auto hash = hash::combine(hash::FnvOffset, key);
+		hash = hash::combine(hash, value.value);
+		sum += mix(hash::combine(hash, value.filetype));
+	}
+	return hash::combine(hash::combine(Schema, section.name), std::string_view(reinterpret_cast<const char*>(&sum), sizeof(sum)));
+}
+
+// 按字符串长度和容器节点的大致开销估算, 只用于控制内存上限
+size_t ResultCache::footprint(const Entry& entry) {
+	constexpr size_t Node = 32;
+	size_t size = sizeof(Entry) + Node + entry.section.size();
+	for (const auto& log : entry.logs)
+		size += sizeof(Diagnostic) + log.key.size() + log.args.size();
+	for (const auto& [name, type] : entry.references)
+		size += sizeof(std::pair<std::string, std::string>) + name.size() + type.size();
+	for (const auto& name : entry.lookups)
+		size += sizeof(std::string) + name.size();
+	return size;
+}
+
+size_t ResultCache::footprint(const NameMap<uint64_t>& hashes) {
+	constexpr size_t Node = 32;
+	size_t size = hashes.bucket_count() * sizeof(void*);
+	for (const auto& [name, _] : hashes)
+		size += Node + sizeof(std::string) + sizeof(uint64_t) + name.size();
+	return size;
+}
+
+void ResultCache::store(uint64_t key, Entry entry) {
+	for (const auto& name : entry.lookups)
+		Referrers[name].insert(entry.section);
+	Current.insert_or_assign(key, std::move(entry));
+}
+
+ResultCache::Scope::Scope(const Section& section, const std::string& type) {
+	if (!Enabled)
+		return;
+	auto it = Hashes.find(section.name);
+	auto hash = it != Hashes.end() ? it->second : hashSection(section);
+	Frame frame{ &section, hash::combine(hash, type) };
+	frame.entry.section = section.name;
+	Frames.push_back(std::move(frame));
+}
+
+// 回放的条目从上次的结果移入, 已经计入用量; 新的结果超出内存上限时丢弃
+ResultCache::Scope::~Scope() {
+	if (!Enabled)
+		return;
+	auto& frame = Frames.back();
+	if (frame.cacheable && !frame.replaying) {
+		auto bytes = footprint(frame.entry);
+		size_t limit = Settings::Instance ? Settings::Instance->logMemoryLimit << 20 : 0;
+		if (!limit || MemoryUsage + bytes <= limit / 2) {
+			MemoryUsage += bytes;
+			store(frame.key, std::move(frame.entry));
+		}
+	}
+	Frames.pop_back();
+}
+
+bool ResultCache::Scope::replay() {
+	if (!Enabled)
+		return false;
+	auto& frame = Frames.back();
+	if (Dirty.contains(frame.section->name))
+		return false;
+	auto it = Previous.find(frame.key);
+	if (it == Previous.end())
+		return false;
+
+	++Hits;
+	frame.replaying = true;
+	const auto& section = *frame.section;
+	auto key = frame.key;
+	store(key, std::move(it->second));
+	const auto& entry = Current.at(key);
+	for (const auto& log : entry.logs) {
+		auto logdata = log.isSectionName
+			? LogData(section.name, section.fileIndex, section.line, true)
+			: LogData(section, log.key);
+		Log::append(static_cast<Severity>(log.severity), logdata, log.rule, LogRecord::decodeArgs(log.args));
+	}
+
+	// 被引用的节各自查找缓存, 已检查过的节会直接跳过
+	for (const auto& [name, type] : entry.references)
+		Checker::Instance->validateSection(name, type);
+	return true;
+}
+
+void ResultCache::reference(const std::string& name, const std::string& type) {
+	if (!Frames.empty() && !Frames.back().replaying)
+		Frames.back().entry.references.emplace_back(name, type);
+}
+
+void ResultCache::lookup(const std::string& name) {
+	if (!Frames.empty() && !Frames.back().replaying)
+		Frames.back().entry.lookups.push_back(name);
+}
+
+void ResultCache::uncacheable() {
+	if (!Frames.empty())
+		Frames.back().cacheable = false;
+}
+
+// 日志必须定位到本节的节名或某个键上, 回放时才能按节当前的位置重新生成
+void ResultCache::record(Severity severity, const LogData& logdata, LogRule rule, const std::vector<LogArg>& args) {
+	if (Frames.empty() || Frames.back().replaying)
+		return;
+	auto& frame = Frames.back();
+	if (!frame.cacheable)
+		return;
+
+	const auto& section = *frame.section;
+	Diagnostic log{ static_cast<uint8_t>(severity), rule };
+	if (logdata.isSectionName && logdata.origin == section.name && logdata.line == section.line && logdata.fileindex == section.fileIndex)
+		log.isSectionName = true;
+	else if (logdata.section == section.name) {
+		for (const auto& [key, value] : section) {
+			if (value.line == logdata.line && value.fileIndex == logdata.fileindex && value.origin == logdata.origin) {
+				log.key = key;
+				break;
+			}
+		}
+		if (log.key.empty()) {
+			frame.cacheable = false;
+			return;
+		}
+	}
+	else {
+		frame.cacheable = false;
+		return;
+	}
+
+	LogRecord::encodeArgs(log.args, args);
+	frame.entry.logs.push_back(std::move(log));
+}
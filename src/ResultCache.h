@@ -0,0 +1,87 @@
+﻿#pragma once
+#include "IniFile.h"
+#include "Log.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 检查结果缓存: 以节的内容哈希为键, 保存该节检查时产生的日志
+// 哈希包含节名、继承展开后的所有键值、检查类型和配置版本
+// 被引用的节各自有缓存条目, 命中时按记录的顺序继续检查这些节, 因此引用链上任何一节改变都只影响该节自身
+// 引用关系另外记录为反向索引, 节新增、删除或改变时, 引用它的节即使内容未变也要重新检查
+// 调用了脚本或插件的节, 以及日志无法定位到本节键上的节不缓存, 每次都重新检查
+// 只在监视模式或设置了缓存文件时启用, 此时同一进程中反复检查也使用内存中的缓存, 设置了缓存文件时才在进程之间保存
+// 缓存与日志共用LogMemoryLimit, 最多占用一半, 超出后新的结果不再保存, 对应的节下次重新检查
+class ResultCache {
+public:
+	static void init(const std::string& path, const std::vector<std::string>& schemaFiles, bool watch);
+	static void begin(const IniFile::Sections& sections);	// 每次检查开始时调用, 与上次的结果比较, 找出需要重新检查的节
+	static void save();										// 只保存本次检查用到的条目, 已删除的节不会一直留在文件中
+
+	// 一个节的检查过程, 构造时取得节的哈希, 析构时保存期间记录的日志
+	// 同一线程中嵌套的Scope构成栈, 日志只记录到栈顶的节
+	class Scope {
+	public:
+		Scope(const Section& section, const std::string& type);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		bool replay();	// 命中时回放日志并检查引用的节, 返回false时需要正常检查
+	};
+
+	static void reference(const std::string& name, const std::string& type);	// 当前节检查了另一个节
+	static void lookup(const std::string& name);	// 当前节的值引用了某个节名, 无论该节是否存在
+	static void uncacheable();	// 当前节的结果依赖于节以外的状态, 不保存
+	static void record(Severity severity, const LogData& logdata, LogRule rule, const std::vector<LogArg>& args);
+
+	static size_t Hits;			// 本次检查中命中缓存的节数
+	static size_t Changed;		// 与上次检查相比新增、删除或内容改变的节数
+	static std::atomic<size_t> MemoryUsage;	// 缓存大致占用的字节数, 计入日志的内存上限
+
+private:
+	// 日志的位置以键名记录, 节移动到其他行时回放的行号仍然正确
+	struct Diagnostic {
+		uint8_t severity{ };
+		LogRule rule{ };
+		bool isSectionName{ };	// 为true时定位到节名, 否则定位到key
+		std::string key;
+		std::string args;		// 按LogRecord::encodeArgs编码的参数
+	};
+
+	struct Entry {
+		std::string section;
+		std::vector<Diagnostic> logs;
+		std::vector<std::pair<std::string, std::string>> references;	// 检查时引用的节名和类型, 按检查顺序
+		std::vector<std::string> lookups;								// 值中引用的节名, 用于建立反向索引
+	};
+
+	struct Frame {
+		const Section* section;
+		uint64_t key;
+		Entry entry;
+		bool cacheable{ true };
+		bool replaying{ false };	// 回放中产生的日志已在缓存中, 不再记录
+	};
+
+	static uint64_t hashSection(const Section& section);
+	static size_t footprint(const Entry& entry);
+	static size_t footprint(const NameMap<uint64_t>& hashes);
+	static void store(uint64_t key, Entry entry);
+	static void load();
+
+	static constexpr uint32_t Version = 2;
+	static bool Enabled;
+	static std::string Path;
+	static uint64_t Schema;						// 配置、设置和日志规则的哈希, 改变时整个缓存失效
+	static NameMap<uint64_t> Hashes;			// 本次检查的 节名 <-> 内容哈希
+	static NameMap<uint64_t> PreviousHashes;	// 上次检查的 节名 <-> 内容哈希, 比较后得到改变的节
+	static NameMap<NameSet> Referrers;			// 反向索引: 节名 <-> 值中引用了该节名的节
+	static NameSet Dirty;						// 内容未变但引用的节改变了, 需要重新检查的节
+	static std::unordered_map<uint64_t, Entry> Previous;
+	static std::unordered_map<uint64_t, Entry> Current;
+	static thread_local std::vector<Frame> Frames;
+};
@@ -1,8 +1,25 @@
 ﻿#include "Settings.h"
 #include "Helper.h"
+#include <algorithm>
+#include <charconv>
+#include <iostream>
 
 Settings* Settings::Instance = nullptr;
 
+// 读取非负整数设置项, 格式错误时保留默认值并提示
+static void readSize(const Section& section, const std::string& key, size_t& variable) {
+	if (!section.contains(key))
+		return;
+	const auto& value = section.at(key).value;
+	size_t result = 0;
+	auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+	if (ec != std::errc() || ptr != value.data() + value.size()) {
+		std::cerr << std::format("设置项{}的值\"{}\"不是非负整数, 使用默认值{}", key, value, variable) << std::endl;
+		return;
+	}
+	variable = result;
+}
+
 Settings::Settings(const IniFile& configFile) {
 	load(configFile);
 	Instance = this;
@@ -13,8 +30,36 @@ void Settings::load(const IniFile& configFile) {
 		const auto& section = configFile.sections.at("INIValidator");
 		if (section.contains("FolderPath"))
 			folderPath = section.at("FolderPath");
-		if (section.contains("JsonLog"))
-			jsonLog = string::isBool(section.at("JsonLog"));
+		if (section.contains("JsonLog") && string::isBool(section.at("JsonLog")))
+			logFormat = LogFormat::Json;
+		if (section.contains("LogFormat")) {
+			auto format = section.at("LogFormat").value;
+			std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+			if (format == "json")
+				logFormat = LogFormat::Json;
+			else if (format == "jsonl")
+				logFormat = LogFormat::JsonLines;
+			else if (format == "sarif")
+				logFormat = LogFormat::Sarif;
+			else if (format == "text")
+				logFormat = LogFormat::Text;
+			else
+				std::cerr << std::format("未知的日志格式\"{}\", 可选text, json, jsonl或sarif", section.at("LogFormat").value) << std::endl;
+		}
+		readSize(section, "ConsoleLimit", consoleLimit);
+		readSize(section, "LogMemoryLimit", logMemoryLimit);
+		if (section.contains("Baseline"))
+			baseline = section.at("Baseline");
+		if (section.contains("UpdateBaseline"))
+			updateBaseline = string::isBool(section.at("UpdateBaseline"));
+		if (section.contains("Cache"))
+			cache = section.at("Cache");
+		if (section.contains("Aggregate"))
+			aggregate = string::isBool(section.at("Aggregate"));
+		readSize(section, "AggregateLocations", aggregateLocations);
+		readSize(section, "PythonWorkers", pythonWorkers);
+		readSize(section, "ScriptTimeout", scriptTimeout);
+		readSize(section, "ScriptBudget", scriptBudget);
 	}
 
 	if (configFile.sections.contains("Files")) {
@@ -28,50 +73,29 @@ void Settings::load(const IniFile& configFile) {
 	if (configFile.sections.contains("LogSetting")) {
 		auto& sections = configFile.sections.at("LogSetting");
 
-		#define READ(sections, variable)	\
+		#define READ(variable)	\
 			if (sections.contains(#variable))	\
 				variable = sections.at(#variable);
 
-		READ(sections, KeyNotExist)
-		READ(sections, TypeNotExist)
-		READ(sections, DynamicKeyVariableError)
-		READ(sections, DynamicKeyFormatError)
-
-		READ(sections, UnusedGlobal)
-		READ(sections, UnusedRegistry)
-		READ(sections, SectionExist)
-		READ(sections, UnreachableSection)
-
-		READ(sections, BracketClosed)
-		READ(sections, DuplicateKey)
-		READ(sections, SectionFormat)
-		READ(sections, InheritanceFormat)
-		READ(sections, InheritanceBracketClosed)
-		READ(sections, InheritanceSectionExist)
-		READ(sections, InheritanceDuplicateKey)
-
-		READ(sections, SpaceExistBetweenEqualSign)
-		READ(sections, SpaceLostBetweenEqualSign)
+		LOG_RULES(READ)
 
-		READ(sections, EmptyValue)
-		READ(sections, IllegalValue)
-		READ(sections, OverlongValue)
-		READ(sections, IntIllegal)
-		READ(sections, FloatIllegal)
-		READ(sections, OverlongString)
-		
-		READ(sections, TypeCheckerTypeNotExist)
-
-		READ(sections, NumberCheckerOverRange)
+		#undef READ
+	}
 
-		READ(sections, LimitCheckerPrefixIllegal)
-		READ(sections, LimitCheckerSuffixIllegal)
-		READ(sections, LimitCheckerValueIllegal)
-		READ(sections, LimitCheckerOverRange)
-		READ(sections, ListCheckerUnknownType)
-		READ(sections, ListCheckerRangeIllegal)
-		READ(sections, ListCheckerOverRange)
+	compileTemplates();
+}
 
-		#undef READ
+// 预编译所有日志模板, 格式错误的模板会被清空, 即不输出此类日志
+void Settings::compileTemplates() {
+	templates.assign(static_cast<size_t>(LogRule::Count), LogTemplate());
+	for (size_t i = 1; i < std::size(LogRuleMembers); ++i) {
+		auto& format = this->*LogRuleMembers[i];
+		try {
+			templates[i] = LogTemplate(format);
+		}
+		catch (const std::format_error& e) {
+			std::cerr << "格式错误：" << e.what() << "\n日志模板：" << format << std::endl;
+			format.clear();
+		}
 	}
-}
\ No newline at end of file
+}
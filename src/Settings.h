@@ -1,6 +1,75 @@
 ﻿#pragma once
 #include "IniFile.h"
+#include "LogTemplate.h"
+#include <iterator>
 #include <string>
+#include <vector>
+
+// 所有日志规则, 顺序即规则编号(LogRule), 新增规则时需同时添加Settings成员和对应的宏
+#define LOG_RULES(X)				\
+	X(KeyNotExist)					\
+	X(TypeNotExist)					\
+	X(DynamicKeyVariableError)		\
+	X(DynamicKeyFormatError)		\
+	X(UnusedGlobal)					\
+	X(UnusedRegistry)				\
+	X(SectionExist)					\
+	X(UnreachableSection)			\
+	X(BracketClosed)				\
+	X(DuplicateKey)					\
+	X(SectionFormat)				\
+	X(InheritanceFormat)			\
+	X(InheritanceBracketClosed)		\
+	X(InheritanceSectionExist)		\
+	X(InheritanceDuplicateKey)		\
+	X(SpaceExistBetweenEqualSign)	\
+	X(SpaceLostBetweenEqualSign)	\
+	X(EmptyValue)					\
+	X(IllegalValue)					\
+	X(OverlongValue)				\
+	X(IntIllegal)					\
+	X(FloatIllegal)					\
+	X(OverlongString)				\
+	X(TypeCheckerTypeNotExist)		\
+	X(NumberCheckerOverRange)		\
+	X(LimitCheckerPrefixIllegal)	\
+	X(LimitCheckerSuffixIllegal)	\
+	X(LimitCheckerValueIllegal)		\
+	X(LimitCheckerOverRange)		\
+	X(LimitCheckerPatternIllegal)	\
+	X(LimitCheckerPatternInvalid)	\
+	X(ListCheckerUnknownType)		\
+	X(ListCheckerRangeIllegal)		\
+	X(ListCheckerOverRange)			\
+	X(TupleCheckerUnknownType)		\
+	X(TupleCheckerCountIllegal)		\
+	X(TupleCheckerGroupIllegal)		\
+	X(TupleCheckerRepeatOverRange)	\
+	X(TupleCheckerNotRegistered)	\
+	X(TupleCheckerOptionalIllegal)	\
+	X(TupleCheckerRepeatIllegal)	\
+	X(ConstraintCheckerFailed)		\
+	X(ConstraintCheckerInvalid)		\
+	X(UniqueCheckerDuplicate)		\
+	X(CustomCheckerTimeout)			\
+	X(CustomCheckerBudgetExceeded)
+
+// 日志规则编号, Text代表不经过模板直接输出的文本
+enum class LogRule : unsigned short {
+	Text,
+#define LOG_RULE_ENUM(name) name,
+	LOG_RULES(LOG_RULE_ENUM)
+#undef LOG_RULE_ENUM
+	Count
+};
+
+// 日志文件格式
+enum class LogFormat {
+	Text,		// 纯文本, Checker.log
+	Json,		// JSON数组, Checker.json
+	JsonLines,	// 每行一个JSON对象, Checker.jsonl
+	Sarif,		// SARIF 2.1.0, Checker.sarif
+};
 
 class Settings {
 	using Keywords = std::vector<std::string>;
@@ -9,8 +78,19 @@ public:
 	static Settings* Instance;
 	Settings(const IniFile& configFile);
 	void load(const IniFile& configFile);
-
-	bool jsonLog{ false };
+	const LogTemplate& getTemplate(LogRule rule) const { return templates[static_cast<size_t>(rule)]; }
+
+	LogFormat logFormat{ LogFormat::Text };
+	size_t consoleLimit{ 1000 };				// 控制台最多显示的日志条数, 0为不限制
+	size_t logMemoryLimit{ 256 };				// 日志和检查结果缓存占用内存的上限(MB), 日志超过后溢出到临时文件, 0为不限制
+	std::string baseline;						// 基线文件路径, 为空时不启用基线
+	bool updateBaseline{ false };				// 用本次结果重新生成基线文件
+	std::string cache;							// 检查结果缓存文件路径, 为空时不启用缓存
+	bool aggregate{ false };					// 文本相同的日志合并为一条, 附上出现次数
+	size_t aggregateLocations{ 5 };				// 合并后的日志最多列出的位置数
+	size_t pythonWorkers{ 0 };					// 并行执行Python脚本的子解释器或工作进程数量, 0为CPU核心数(Python 3.12以下为1), 1为不并行
+	size_t scriptTimeout{ 0 };					// Python脚本单次调用的时限(毫秒), 超时的调用会被中断, 0为不限制
+	size_t scriptBudget{ 0 };					// 每个Python脚本累计耗时的上限(毫秒), 超出后跳过该脚本其余检查, 0为不限制
 
 	std::string folderPath;
 	std::string defaultFile;
@@ -57,12 +137,58 @@ public:
 	std::string LimitCheckerSuffixIllegal{ };
 	std::string LimitCheckerValueIllegal{ };
 	std::string LimitCheckerOverRange{ };
+	std::string LimitCheckerPatternIllegal{ };
+	std::string LimitCheckerPatternInvalid{ };
 
 	std::string ListCheckerUnknownType{ };
 	std::string ListCheckerRangeIllegal{ };
 	std::string ListCheckerOverRange{ };
+
+	std::string TupleCheckerUnknownType{ };
+	std::string TupleCheckerCountIllegal{ };
+	std::string TupleCheckerGroupIllegal{ };
+	std::string TupleCheckerRepeatOverRange{ };
+	std::string TupleCheckerNotRegistered{ };
+	std::string TupleCheckerOptionalIllegal{ };
+	std::string TupleCheckerRepeatIllegal{ };
+	std::string ConstraintCheckerFailed{ };
+	std::string ConstraintCheckerInvalid{ };
+	std::string UniqueCheckerDuplicate{ };
+
+	std::string CustomCheckerTimeout{ };
+	std::string CustomCheckerBudgetExceeded{ };
+
+private:
+	void compileTemplates();
+
+	std::vector<LogTemplate> templates;			// 预编译的日志模板, 下标为LogRule
+};
+
+// LogRule <-> Settings成员的映射表, 下标为LogRule
+inline constexpr std::string Settings::* LogRuleMembers[] = {
+	nullptr,
+#define LOG_RULE_MEMBER(name) &Settings::name,
+	LOG_RULES(LOG_RULE_MEMBER)
+#undef LOG_RULE_MEMBER
 };
 
+// LogRule <-> 规则名, 用于机器可读的日志格式
+inline constexpr const char* LogRuleNames[] = {
+	"Text",
+#define LOG_RULE_NAME(name) #name,
+	LOG_RULES(LOG_RULE_NAME)
+#undef LOG_RULE_NAME
+};
+
+// 编译期将Settings成员指针转换为规则编号
+template <auto Member>
+constexpr LogRule getLogRule() {
+	for (size_t i = 1; i < std::size(LogRuleMembers); ++i)
+		if (LogRuleMembers[i] == Member)
+			return static_cast<LogRule>(i);
+	return LogRule::Text;
+}
+
 #define _KeyNotExist &Settings::KeyNotExist
 #define _TypeNotExist &Settings::TypeNotExist
 #define _DynamicKeyVariableError &Settings::DynamicKeyVariableError
@@ -100,7 +226,23 @@ public:
 #define _LimitCheckerSuffixIllegal &Settings::LimitCheckerSuffixIllegal
 #define _LimitCheckerValueIllegal &Settings::LimitCheckerValueIllegal
 #define _LimitCheckerOverRange &Settings::LimitCheckerOverRange
+#define _LimitCheckerPatternIllegal &Settings::LimitCheckerPatternIllegal
+#define _LimitCheckerPatternInvalid &Settings::LimitCheckerPatternInvalid
 
 #define _ListCheckerUnknownType &Settings::ListCheckerUnknownType
 #define _ListCheckerRangeIllegal &Settings::ListCheckerRangeIllegal
-#define _ListCheckerOverRange &Settings::ListCheckerOverRange
\ No newline at end of file
+#define _ListCheckerOverRange &Settings::ListCheckerOverRange
+
+#define _TupleCheckerUnknownType &Settings::TupleCheckerUnknownType
+#define _TupleCheckerCountIllegal &Settings::TupleCheckerCountIllegal
+#define _TupleCheckerGroupIllegal &Settings::TupleCheckerGroupIllegal
+#define _TupleCheckerRepeatOverRange &Settings::TupleCheckerRepeatOverRange
+#define _TupleCheckerNotRegistered &Settings::TupleCheckerNotRegistered
+#define _TupleCheckerOptionalIllegal &Settings::TupleCheckerOptionalIllegal
+#define _TupleCheckerRepeatIllegal &Settings::TupleCheckerRepeatIllegal
+#define _ConstraintCheckerFailed &Settings::ConstraintCheckerFailed
+#define _ConstraintCheckerInvalid &Settings::ConstraintCheckerInvalid
+#define _UniqueCheckerDuplicate &Settings::UniqueCheckerDuplicate
+
+#define _CustomCheckerTimeout &Settings::CustomCheckerTimeout
+#define _CustomCheckerBudgetExceeded &Settings::CustomCheckerBudgetExceeded
\ No newline at end of file
@@ -0,0 +1,110 @@
+﻿#include "Helper.h"
+#include "Profiler.h"
+#include "TargetFiles.h"
+#include <algorithm>
+#include <set>
+
+TargetFiles::TargetFiles(std::vector<std::string> paths) :paths(std::move(paths)) {
+}
+
+std::filesystem::path TargetFiles::normalize(const std::filesystem::path& path) {
+	return std::filesystem::absolute(path).lexically_normal();
+}
+
+// Windows的文件名不区分大小写, include中的写法可能与实际文件名不同
+static bool samePath(const std::filesystem::path& l, const std::filesystem::path& r) {
+#ifdef _WIN32
+	return fold::equal(l.string(), r.string());
+#else
+	return l == r;
+#endif
+}
+
+std::vector<std::filesystem::path> TargetFiles::expand() const {
+	std::vector<std::filesystem::path> files;
+	for (const auto& arg : paths) {
+		std::filesystem::path path(arg);
+		if (std::filesystem::is_regular_file(path))
+			files.push_back(normalize(path));
+		else if (std::filesystem::is_directory(path))
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+				if (entry.is_regular_file() && entry.path().extension() == ".ini")
+					files.push_back(normalize(entry.path()));
+	}
+	return files;
+}
+
+void TargetFiles::load(IniFile& targetIni) {
+	loadFrom(targetIni, 0, expand());
+}
+
+// 加载每个文件时记录被修改的节原来的状态, 之后从这个文件开始重新加载时逐个撤销
+void TargetFiles::loadFrom(IniFile& targetIni, size_t index, const std::vector<std::filesystem::path>& files) {
+	for (size_t i = index; i < files.size(); ++i) {
+		Source source{ files[i], {}, {}, IniFile::FileIndex, IniFile::FileNames.size(), IniFile::AppendCount };
+		targetIni.files.clear();
+		targetIni.journal = &source.undo;
+		{
+			Log::Capture capture(source.logs);
+			targetIni.load(files[i].string());
+		}
+		targetIni.journal = nullptr;
+		for (const auto& file : targetIni.files)
+			source.files.push_back(normalize(file));
+		sources.push_back(std::move(source));
+	}
+}
+
+bool TargetFiles::reload(IniFile& targetIni, const std::vector<std::filesystem::path>& changed, bool force) {
+	Profiler::Scope profile(Profiler::Category::Phase, "重新加载文件");
+	// 改变的路径是目录时, 代表监视通知丢失, 目录中的文件都视为改变
+	auto touched = [&](const Source& source) {
+		return std::any_of(source.files.begin(), source.files.end(), [&](const std::filesystem::path& file) {
+			return std::any_of(changed.begin(), changed.end(), [&](const std::filesystem::path& path) {
+				return samePath(file, path) || samePath(file.parent_path(), path);
+			});
+		});
+	};
+
+	// 找到第一个改变的文件, 目录中新增或删除的ini也会使之后的文件顺序改变
+	auto files = expand();
+	size_t index = 0;
+	while (index < sources.size() && index < files.size() && samePath(sources[index].path, files[index]) && !touched(sources[index]))
+		++index;
+	if (index == sources.size() && index == files.size() && !force)
+		return false;
+
+	// 从最后一个文件起逐个撤销, 恢复到加载第一个改变的文件之前, 之前的文件只重新产生加载时的日志
+	for (size_t i = sources.size(); i > index; --i)
+		for (auto& [name, section] : sources[i - 1].undo) {
+			if (section)
+				targetIni.sections.insert_or_assign(name, std::move(*section));
+			else
+				targetIni.sections.erase(name);
+		}
+	if (index < sources.size()) {
+		IniFile::FileIndex = sources[index].fileIndex;
+		IniFile::FileNames.resize(sources[index].fileCount);
+		IniFile::AppendCount = sources[index].appendCount;
+		sources.resize(index);
+	}
+	// 未撤销的节仍带有上次检查的标记
+	for (auto& [_, section] : targetIni.sections)
+		section.isScanned = false;
+
+	for (const auto& source : sources)
+		Log::replay(source.logs);
+	loadFrom(targetIni, index, files);
+	return true;
+}
+
+std::vector<std::filesystem::path> TargetFiles::directories() const {
+	std::set<std::filesystem::path> directories;
+	for (const auto& arg : paths)
+		if (std::filesystem::is_directory(arg))
+			directories.insert(normalize(arg));
+	for (const auto& source : sources)
+		for (const auto& file : source.files)
+			directories.insert(file.parent_path());
+	return { directories.begin(), directories.end() };
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include "IniFile.h"
+#include "Log.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// 监视模式下的目标文件: 记录每个顶层文件加载时修改的节原来的状态和加载时产生的日志
+// 文件改变时从第一个改变的文件开始重新加载, 之前的文件不再解析, 只重新产生其日志
+// 之后的文件也要重新加载, 因为它们可能覆盖或继承改变的文件中的节
+class TargetFiles {
+public:
+	explicit TargetFiles(std::vector<std::string> paths);
+
+	void load(IniFile& targetIni);
+	// changed中有目标文件或其include的文件, 或目录中的ini增删时重新加载并返回true
+	// force为true时即使没有改变也恢复到未检查的状态, 用于脚本改变后重新检查
+	bool reload(IniFile& targetIni, const std::vector<std::filesystem::path>& changed, bool force = false);
+	std::vector<std::filesystem::path> directories() const;	// 需要监视的目录
+
+private:
+	struct Source {
+		std::filesystem::path path;
+		std::vector<std::filesystem::path> files;	// 该文件及其include的文件
+		IniFile::Journal undo;						// 加载该文件时修改的节在加载前的状态, 只占用与改动成正比的内存
+		size_t fileIndex;
+		size_t fileCount;
+		size_t appendCount;							// 加载前的IniFile::AppendCount, 重新加载时+=键得到相同的键名
+		std::vector<LogEntry> logs;					// 加载时产生的日志
+	};
+
+	static std::filesystem::path normalize(const std::filesystem::path& path);
+	std::vector<std::filesystem::path> expand() const;	// 参数中的文件和目录展开为要加载的文件, 顺序与非监视模式相同
+	void loadFrom(IniFile& targetIni, size_t index, const std::vector<std::filesystem::path>& files);
+
+	std::vector<std::string> paths;
+	std::vector<Source> sources;
+};
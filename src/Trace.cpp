@@ -0,0 +1,110 @@
+﻿#include "Trace.h"
+#include "OutputBuffer.h"
+#include <format>
+#include <fstream>
+#include <iostream>
+
+bool Trace::Enabled = false;
+std::string Trace::Path;
+Trace::TimePoint Trace::Epoch;
+std::vector<std::unique_ptr<Trace::Ring>> Trace::Rings;
+std::mutex Trace::ringMutex;
+
+void Trace::init(const std::string& path) {
+	Path = path;
+	Enabled = !path.empty();
+	Epoch = std::chrono::steady_clock::now();
+	if (Enabled)
+		localRing(); // 由主线程调用, 使主线程的编号为1
+}
+
+// 逐键的检查器和类型调用过于密集, 只记录统计表, 不进入时间线
+bool Trace::traced(Profiler::Category category) {
+	switch (category) {
+	case Profiler::Category::Phase:
+	case Profiler::Category::Script:
+	case Profiler::Category::Registry:
+		return true;
+	default:
+		return false;
+	}
+}
+
+const std::string* Trace::Ring::intern(std::string_view str) {
+	auto it = names.find(str);
+	if (it == names.end())
+		it = names.emplace(str).first;
+	return &*it;
+}
+
+// 获取当前线程的环形缓冲区, 首次调用时登记到Rings中
+Trace::Ring& Trace::localRing() {
+	thread_local Ring* ring = nullptr;
+	if (!ring) {
+		std::lock_guard<std::mutex> lock(ringMutex);
+		ring = Rings.emplace_back(std::make_unique<Ring>()).get();
+		ring->threadId = Rings.size();
+		ring->events.resize(Capacity);
+	}
+	return *ring;
+}
+
+void Trace::record(Profiler::Category category, std::string_view name, std::string_view detail, TimePoint start, TimePoint end) {
+	if (!traced(category))
+		return;
+
+	auto& ring = localRing();
+	ring.events[ring.next] = { ring.intern(name), detail.empty() ? nullptr : ring.intern(detail), category, start, end };
+	if (++ring.next == Capacity) {
+		ring.next = 0;
+		ring.wrapped = true;
+	}
+}
+
+// 写出所有线程的事件, 时间以微秒为单位, 从程序启动开始计算
+void Trace::flush() {
+	if (!Enabled)
+		return;
+
+	std::ofstream file(Path, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "无法写入跟踪文件: " << Path << std::endl;
+		return;
+	}
+
+	auto micros = [](TimePoint time) {
+		return std::chrono::duration<double, std::micro>(time - Epoch).count();
+	};
+
+	std::lock_guard<std::mutex> lock(ringMutex);
+	OutputBuffer buffer(file);
+	buffer << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	bool first = true;
+	for (auto& ring : Rings) {
+		buffer << (first ? "\n" : ",\n")
+			<< "\t{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << ring->threadId
+			<< ", \"args\": {\"name\": ";
+		buffer.json(ring->threadId == 1 ? "主线程" : std::format("线程{}", ring->threadId)) << "}}";
+		first = false;
+
+		// 环形缓冲区写满过时, 从最早的事件开始
+		size_t begin = ring->wrapped ? ring->next : 0;
+		size_t count = ring->wrapped ? Capacity : ring->next;
+		for (size_t i = 0; i < count; ++i) {
+			const auto& event = ring->events[(begin + i) % Capacity];
+			buffer << ",\n\t{\"ph\": \"X\", \"pid\": 1, \"tid\": " << ring->threadId
+				<< ", \"cat\": \"" << Profiler::GetCategoryName(event.category) << "\", \"name\": ";
+			buffer.json(*event.name)
+				<< std::format(", \"ts\": {:.3f}, \"dur\": {:.3f}", micros(event.start), micros(event.end) - micros(event.start));
+			if (event.detail) {
+				buffer << ", \"args\": {\"detail\": ";
+				buffer.json(*event.detail) << '}';
+			}
+			buffer << '}';
+			buffer.commit();
+		}
+		ring->next = 0;
+		ring->wrapped = false;
+	}
+	buffer << "\n]}\n";
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+#include "Profiler.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// 时间线跟踪, 命令行加上--trace out.json启用
+// 以Chrome trace event格式记录文件加载、include、各注册表的检查、Python脚本调用和日志输出,
+// 可在chrome://tracing或Perfetto中查看各线程的时间线
+// 事件来自Profiler::Scope, 每个线程写入自己的环形缓冲区, 写满后覆盖最早的事件, 检查结束后统一写出
+class Trace {
+public:
+	using TimePoint = std::chrono::steady_clock::time_point;
+
+	static void init(const std::string& path);
+	static void record(Profiler::Category category, std::string_view name, std::string_view detail, TimePoint start, TimePoint end);
+	static void flush();	// 写出并清空本次检查的事件
+
+	static bool Enabled;
+
+private:
+	static constexpr size_t Capacity = 1 << 16;	// 每个线程保留的事件数
+
+	struct StringHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+	};
+
+	struct Event {
+		const std::string* name;
+		const std::string* detail;
+		Profiler::Category category;
+		TimePoint start;
+		TimePoint end;
+	};
+
+	struct Ring {
+		size_t threadId{ };
+		size_t next{ };			// 下一个写入位置
+		bool wrapped{ false };	// 是否已覆盖过旧事件
+		std::vector<Event> events;
+		std::unordered_set<std::string, StringHash, std::equal_to<>> names;	// 事件名, 节点地址固定
+
+		const std::string* intern(std::string_view str);
+	};
+
+	static bool traced(Profiler::Category category);
+	static Ring& localRing();
+
+	static std::string Path;
+	static TimePoint Epoch;
+	static std::vector<std::unique_ptr<Ring>> Rings;
+	static std::mutex ringMutex;
+};
@@ -0,0 +1,178 @@
+﻿#include "Log.h"
+#include "Watcher.h"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+
+struct Watcher::Directory {
+	std::filesystem::path path;
+	HANDLE handle{ INVALID_HANDLE_VALUE };
+	OVERLAPPED overlapped{ };
+	bool pending{ false };
+	alignas(DWORD) char buffer[16384];
+
+	// 每次取得结果后重新提交请求, 两次请求之间的改变由系统缓存
+	bool listen() {
+		pending = ReadDirectoryChangesW(handle, buffer, sizeof(buffer), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr);
+		return pending;
+	}
+
+	~Directory() {
+		// 等待取消完成后才能释放buffer
+		if (pending) {
+			DWORD bytes = 0;
+			CancelIoEx(handle, &overlapped);
+			GetOverlappedResult(handle, &overlapped, &bytes, TRUE);
+		}
+		if (handle != INVALID_HANDLE_VALUE)
+			CloseHandle(handle);
+		if (overlapped.hEvent)
+			CloseHandle(overlapped.hEvent);
+	}
+};
+
+Watcher::Watcher() = default;
+Watcher::~Watcher() = default;
+
+void Watcher::add(const std::filesystem::path& directory) {
+	auto path = std::filesystem::absolute(directory).lexically_normal();
+	if (std::any_of(directories.begin(), directories.end(), [&](const auto& dir) { return dir->path == path; }))
+		return;
+	// WaitForMultipleObjects最多等待64个对象
+	if (directories.size() >= MAXIMUM_WAIT_OBJECTS) {
+		Log::out("监视的目录过多, 忽略: {}", path.string());
+		return;
+	}
+
+	auto dir = std::make_unique<Directory>();
+	dir->path = path;
+	dir->handle = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	dir->overlapped.hEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+	if (dir->handle == INVALID_HANDLE_VALUE || !dir->overlapped.hEvent || !dir->listen()) {
+		Log::out("无法监视目录: {}", path.string());
+		return;
+	}
+	directories.push_back(std::move(dir));
+}
+
+std::vector<std::filesystem::path> Watcher::wait(std::chrono::milliseconds quiet) {
+	std::set<std::filesystem::path> changed;
+	std::vector<HANDLE> events;
+	for (const auto& dir : directories)
+		events.push_back(dir->overlapped.hEvent);
+	if (events.empty())
+		throw std::runtime_error("没有可监视的目录");
+
+	DWORD timeout = INFINITE;
+	while (true) {
+		auto result = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, timeout);
+		if (result == WAIT_TIMEOUT)
+			break;
+		if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + events.size())
+			throw std::runtime_error(std::format("等待文件改变失败, 错误码: {}", GetLastError()));
+
+		auto& dir = *directories[result - WAIT_OBJECT_0];
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(dir.handle, &dir.overlapped, &bytes, FALSE) || bytes == 0)
+			changed.insert(dir.path);
+		else {
+			for (DWORD offset = 0;;) {
+				auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(dir.buffer + offset);
+				changed.insert(dir.path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+				if (!info->NextEntryOffset)
+					break;
+				offset += info->NextEntryOffset;
+			}
+		}
+		dir.listen();
+		timeout = static_cast<DWORD>(quiet.count());
+	}
+	return { changed.begin(), changed.end() };
+}
+
+#else
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+struct Watcher::Directory {
+	std::filesystem::path path;
+	int wd{ -1 };
+};
+
+Watcher::Watcher() :fd(inotify_init1(IN_CLOEXEC)) {
+	if (fd < 0)
+		Log::out("无法创建inotify实例");
+}
+
+Watcher::~Watcher() {
+	if (fd >= 0)
+		close(fd);
+}
+
+void Watcher::add(const std::filesystem::path& directory) {
+	auto path = std::filesystem::absolute(directory).lexically_normal();
+	if (fd < 0 || std::any_of(directories.begin(), directories.end(), [&](const auto& dir) { return dir->path == path; }))
+		return;
+
+	// 编辑器保存时可能先写临时文件再重命名, 因此同时监视写入完成和移入
+	int wd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+	if (wd < 0) {
+		Log::out("无法监视目录: {}", path.string());
+		return;
+	}
+	directories.push_back(std::make_unique<Directory>(Directory{ path, wd }));
+}
+
+std::vector<std::filesystem::path> Watcher::wait(std::chrono::milliseconds quiet) {
+	std::set<std::filesystem::path> changed;
+	if (fd < 0 || directories.empty())
+		throw std::runtime_error("没有可监视的目录");
+
+	// 被信号中断时重新等待, 其余错误无法恢复
+	auto fail = [](const char* operation) {
+		throw std::runtime_error(std::format("等待文件改变失败: {}: {}", operation, std::strerror(errno)));
+	};
+	int timeout = -1;
+	while (true) {
+		pollfd pfd{ fd, POLLIN, 0 };
+		int ready = poll(&pfd, 1, timeout);
+		if (ready < 0 && errno == EINTR)
+			continue;
+		if (ready < 0)
+			fail("poll");
+		if (ready == 0)
+			break;
+
+		alignas(inotify_event) char buffer[16384];
+		auto length = read(fd, buffer, sizeof(buffer));
+		if (length < 0 && errno == EINTR)
+			continue;
+		if (length <= 0)
+			fail("read");
+		for (char* p = buffer; p < buffer + length;) {
+			auto event = reinterpret_cast<const inotify_event*>(p);
+			if (event->mask & IN_Q_OVERFLOW) {
+				for (const auto& dir : directories)
+					changed.insert(dir->path);
+			}
+			else if (event->len) {
+				auto dir = std::find_if(directories.begin(), directories.end(), [&](const auto& dir) { return dir->wd == event->wd; });
+				if (dir != directories.end())
+					changed.insert((*dir)->path / event->name);
+			}
+			p += sizeof(inotify_event) + event->len;
+		}
+		timeout = static_cast<int>(quiet.count());
+	}
+	return { changed.begin(), changed.end() };
+}
+#endif
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+// 监视目录中文件的写入、新建、删除和重命名
+// Windows上每个目录一个ReadDirectoryChangesW异步请求, Linux上所有目录共用一个inotify描述符
+class Watcher {
+public:
+	Watcher();
+	~Watcher();
+	Watcher(const Watcher&) = delete;
+	Watcher& operator=(const Watcher&) = delete;
+
+	void add(const std::filesystem::path& directory);	// 同一目录只监视一次, 不包括子目录
+
+	// 阻塞到有文件改变, 之后继续收集改变, 直到quiet时间内没有新的改变才返回, 连续保存只触发一次检查
+	// 返回改变的文件路径; 通知过多而丢失时返回目录本身, 代表该目录中的任何文件都可能改变
+	// 没有可监视的目录或等待失败时抛出runtime_error, 不会返回空列表
+	std::vector<std::filesystem::path> wait(std::chrono::milliseconds quiet);
+
+private:
+	struct Directory;
+	std::vector<std::unique_ptr<Directory>> directories;
+	int fd{ -1 };	// inotify描述符, 仅Linux使用
+};